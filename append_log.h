@@ -0,0 +1,356 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Вектор записей только для дописывания, сохраняемый в файл.
+// Формат файла: сигнатура LOG_MAGIC, размер записи (4 байта), затем кадры
+// [CRC32C записи: 4 байта][запись]. Дописанные записи копятся в буфере и уходят
+// в файл одной записью с одним fdatasync на пакет из batch_size записей (групповая фиксация)
+// или при явном Commit. При открытии кадры проверяются по порядку; недописанный
+// или испорченный хвост, оставшийся после сбоя, отрезается, так что в файле остаётся
+// префикс дописанных записей. Как и SimpleVector, объект не потокобезопасен
+namespace append_log_detail {
+
+constexpr char LOG_MAGIC[8] = {'S', 'V', 'A', 'P', 'L', 'O', 'G', '1'};
+constexpr size_t HEADER_SIZE = sizeof(LOG_MAGIC) + sizeof(uint32_t);
+constexpr size_t CHECKSUM_SIZE = sizeof(uint32_t);
+// Сколько байт файла читается за раз при открытии
+constexpr size_t RECOVER_CHUNK_SIZE = size_t{1} << 16;
+
+// Таблица CRC32C (полином Кастаньоли, отражённый 0x82F63B78)
+constexpr std::array<uint32_t, 256> MakeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+inline constexpr std::array<uint32_t, 256> CRC_TABLE = MakeCrcTable();
+
+// CRC32C инструкцией crc32 (SSE4.2), если она доступна, иначе по таблице
+inline uint32_t Crc32c(const char* data, size_t size) noexcept {
+    uint32_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+#if defined(__SSE4_2__)
+    uint64_t wide = crc;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<uint32_t>(wide);
+    for (; i < size; ++i) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(data[i]));
+    }
+#else
+    for (; i < size; ++i) {
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF];
+    }
+#endif
+    return ~crc;
+}
+
+// Записывает size байт целиком, повторяя прерванные и частичные вызовы write
+inline void WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t count = ::write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "write failed");
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+}
+
+// Читает до size байт, повторяя прерванные и частичные вызовы read;
+// меньше size возвращается только в конце файла
+inline size_t ReadUpTo(int fd, char* data, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        const ssize_t count = ::read(fd, data + total, size - total);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read failed");
+        }
+        if (count == 0) {
+            break;
+        }
+        total += static_cast<size_t>(count);
+    }
+    return total;
+}
+
+inline void SyncData(int fd) {
+#if defined(__linux__)
+    const int result = ::fdatasync(fd);
+#else
+    const int result = ::fsync(fd);
+#endif
+    if (result != 0) {
+        throw std::system_error(errno, std::generic_category(), "fdatasync failed");
+    }
+}
+
+// Закрепляет на диске запись о новом файле в каталоге
+inline void SyncParentDirectory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "cannot open " + directory);
+    }
+    const int result = ::fsync(fd);
+    const int error = errno;
+    ::close(fd);
+    if (result != 0) {
+        throw std::system_error(error, std::generic_category(), "fsync failed for " + directory);
+    }
+}
+
+}  // namespace append_log_detail
+
+template <typename Record>
+class AppendLog {
+    static_assert(std::is_trivially_copyable_v<Record>, "AppendLog stores records as raw bytes");
+
+public:
+    static constexpr size_t DEFAULT_BATCH_SIZE = 64;
+
+    // Открывает или создаёт файл и восстанавливает записи из него.
+    // Выбрасывает std::system_error при ошибке ввода-вывода и std::invalid_argument,
+    // если файл не журнал или записан для записей другого размера; такой файл не изменяется
+    explicit AppendLog(const std::string& path, size_t batch_size = DEFAULT_BATCH_SIZE)
+        : batch_size_(std::max<size_t>(batch_size, 1))
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+        }
+        try {
+            Recover(path);
+        }
+        catch (...) {
+            ::close(fd_);
+            throw;
+        }
+        pending_.Reserve(batch_size_ * FRAME_SIZE);
+    }
+
+    AppendLog(const AppendLog&) = delete;
+    AppendLog& operator=(const AppendLog&) = delete;
+
+    // Фиксирует оставшиеся записи; ошибка фиксации здесь теряется, поэтому
+    // записи, которые нельзя потерять, нужно фиксировать явным Commit
+    ~AppendLog() {
+        try {
+            Commit();
+        }
+        catch (...) {
+        }
+        ::close(fd_);
+    }
+
+    // Число записей, включая ещё не зафиксированные
+    size_t GetSize() const noexcept {
+        return records_.GetSize();
+    }
+
+    bool IsEmpty() const noexcept {
+        return records_.IsEmpty();
+    }
+
+    // Число записей, переживающих сбой
+    size_t GetDurableSize() const noexcept {
+        return durable_count_;
+    }
+
+    // Сколько байт испорченного хвоста было отрезано при открытии
+    size_t GetTruncatedBytes() const noexcept {
+        return truncated_bytes_;
+    }
+
+    const Record& operator[](size_t index) const noexcept {
+        return records_[index];
+    }
+
+    const SimpleVector<Record>& GetRecords() const noexcept {
+        return records_;
+    }
+
+    // Дописывает запись; пакет из batch_size записей фиксируется сразу
+    void Append(const Record& record) {
+        char frame[FRAME_SIZE];
+        std::memcpy(frame + append_log_detail::CHECKSUM_SIZE, &record, sizeof(Record));
+        const uint32_t checksum = append_log_detail::Crc32c(frame + append_log_detail::CHECKSUM_SIZE, sizeof(Record));
+        std::memcpy(frame, &checksum, sizeof(checksum));
+        const size_t old_size = pending_.GetSize();
+        pending_.Resize(old_size + FRAME_SIZE);
+        try {
+            records_.PushBack(record);
+        }
+        catch (...) {
+            pending_.Resize(old_size);
+            throw;
+        }
+        std::memcpy(pending_.begin() + old_size, frame, FRAME_SIZE);
+        if (records_.GetSize() - durable_count_ >= batch_size_) {
+            Commit();
+        }
+    }
+
+    // Записывает накопленные записи в файл и дожидается fdatasync.
+    // При ошибке файл обрезается до зафиксированных записей, а накопленные остаются в буфере,
+    // так что Commit можно повторить
+    void Commit() {
+        if (pending_.IsEmpty()) {
+            return;
+        }
+        try {
+            append_log_detail::WriteAll(fd_, pending_.begin(), pending_.GetSize());
+            append_log_detail::SyncData(fd_);
+        }
+        catch (...) {
+            // часть пакета могла попасть в файл: она отрезается, чтобы повтор не удвоил записи
+            if (::ftruncate(fd_, static_cast<off_t>(durable_bytes_)) == 0) {
+                ::lseek(fd_, static_cast<off_t>(durable_bytes_), SEEK_SET);
+            }
+            throw;
+        }
+        durable_bytes_ += pending_.GetSize();
+        durable_count_ = records_.GetSize();
+        pending_.Clear();
+    }
+
+private:
+    static constexpr size_t FRAME_SIZE = append_log_detail::CHECKSUM_SIZE + sizeof(Record);
+
+    void Recover(const std::string& path) {
+        using namespace append_log_detail;
+        struct stat info;
+        if (::fstat(fd_, &info) != 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot stat " + path);
+        }
+        const size_t total = static_cast<size_t>(info.st_size);
+        char header[HEADER_SIZE];
+        const size_t header_read = ReadUpTo(fd_, header, HEADER_SIZE);
+        if (header_read < HEADER_SIZE) {
+            // новый файл или сбой во время записи заголовка
+            if (header_read > 0 && std::memcmp(header, LOG_MAGIC, std::min(header_read, sizeof(LOG_MAGIC))) != 0) {
+                throw std::invalid_argument(path + " is not an append log");
+            }
+            WriteHeader(path);
+            truncated_bytes_ = header_read;
+            return;
+        }
+        uint32_t record_size = 0;
+        std::memcpy(&record_size, header + sizeof(LOG_MAGIC), sizeof(record_size));
+        if (std::memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+            throw std::invalid_argument(path + " is not an append log");
+        }
+        if (record_size != sizeof(Record)) {
+            throw std::invalid_argument(path + " holds records of " + std::to_string(record_size) + " bytes");
+        }
+
+        // Кадры читаются кусками из целого числа кадров; недочитанный конец кадра
+        // переносится в начало буфера и дополняется следующим чтением
+        const size_t chunk_size = std::max<size_t>(RECOVER_CHUNK_SIZE / FRAME_SIZE, 1) * FRAME_SIZE;
+        SimpleVector<char> chunk;
+        chunk.ResizeForOverwrite(chunk_size);
+        records_.Reserve(total > HEADER_SIZE ? (total - HEADER_SIZE) / FRAME_SIZE : 0);
+        size_t offset = HEADER_SIZE;
+        size_t filled = 0;
+        bool at_end = false;
+        while (!at_end) {
+            const size_t count = ReadUpTo(fd_, chunk.begin() + filled, chunk_size - filled);
+            at_end = count < chunk_size - filled;
+            filled += count;
+            const size_t frames = filled / FRAME_SIZE;
+            // записи копируются прямо в хранилище records_, лишнее срезается
+            const size_t first = records_.GetSize();
+            records_.ResizeForOverwrite(first + frames);
+            size_t valid = 0;
+            for (; valid < frames; ++valid) {
+                const char* const frame = chunk.begin() + valid * FRAME_SIZE;
+                uint32_t checksum;
+                std::memcpy(&checksum, frame, sizeof(checksum));
+                if (Crc32c(frame + CHECKSUM_SIZE, sizeof(Record)) != checksum) {
+                    break;
+                }
+                std::memcpy(static_cast<void*>(records_.begin() + first + valid), frame + CHECKSUM_SIZE, sizeof(Record));
+            }
+            offset += valid * FRAME_SIZE;
+            if (valid < frames) {
+                records_.Resize(first + valid);
+                break;
+            }
+            filled -= frames * FRAME_SIZE;
+            std::memmove(chunk.begin(), chunk.begin() + frames * FRAME_SIZE, filled);
+        }
+        if (offset < total) {
+            // всё после первого испорченного кадра не было зафиксировано
+            if (::ftruncate(fd_, static_cast<off_t>(offset)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "cannot truncate " + path);
+            }
+            SyncData(fd_);
+            truncated_bytes_ = total - offset;
+        }
+        if (::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0) {
+            throw std::system_error(errno, std::generic_category(), "lseek failed");
+        }
+        durable_bytes_ = offset;
+        durable_count_ = records_.GetSize();
+    }
+
+    void WriteHeader(const std::string& path) {
+        using namespace append_log_detail;
+        if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) < 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot reset " + path);
+        }
+        char header[HEADER_SIZE];
+        const uint32_t record_size = sizeof(Record);
+        std::memcpy(header, LOG_MAGIC, sizeof(LOG_MAGIC));
+        std::memcpy(header + sizeof(LOG_MAGIC), &record_size, sizeof(record_size));
+        WriteAll(fd_, header, HEADER_SIZE);
+        SyncData(fd_);
+        SyncParentDirectory(path);
+        durable_bytes_ = HEADER_SIZE;
+    }
+
+    int fd_ = -1;
+    size_t batch_size_;
+    // Все записи: зафиксированные, затем накопленные
+    SimpleVector<Record> records_;
+    // Кадры накопленных записей
+    SimpleVector<char> pending_;
+    size_t durable_count_ = 0;
+    size_t durable_bytes_ = 0;
+    size_t truncated_bytes_ = 0;
+};
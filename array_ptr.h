@@ -1,6 +1,10 @@
 ﻿#pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 // Умный указатель, удаляющий связанный объект при своём разрушении.
@@ -8,20 +12,54 @@
 template <typename Type>
 class ArrayPtr {
 public:
+    // Массивы тривиальных типов с обычным выравниванием хранятся в сырой памяти
+    // ::operator new[] и освобождаются ::operator delete[] без учёта типа,
+    // поэтому такой буфер можно передать ArrayPtr другого тривиального типа (FromStorage)
+    static constexpr bool RAW_STORAGE = std::is_trivially_default_constructible_v<Type>
+        && std::is_trivially_destructible_v<Type>
+        && alignof(Type) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
     // Конструктор по умолчанию создаёт нулевой указатель,
     // так как поле ptr_ имеет значение по умолчанию nullptr
     ArrayPtr() = default;
 
-    explicit ArrayPtr(std::size_t size) 
-        : ptr_(new Type[size]()) 
-    {
+    explicit ArrayPtr(std::size_t size) {
+        if constexpr (RAW_STORAGE) {
+            ptr_ = Allocate(size);
+            std::uninitialized_value_construct_n(ptr_, size);
+        }
+        else {
+            ptr_ = new Type[size]();
+        }
     }
 
+    // Принимает указатель, ранее полученный из Release() другого ArrayPtr<Type>
     explicit ArrayPtr(Type* raw_ptr) noexcept 
         : ptr_(raw_ptr) 
     {
     }
 
+    // Создаёт массив, элементы которого инициализируются по умолчанию:
+    // для тривиальных типов память остаётся незаполненной
+    static ArrayPtr Uninitialized(std::size_t size) {
+        if constexpr (RAW_STORAGE) {
+            return ArrayPtr(Allocate(size));
+        }
+        else {
+            return ArrayPtr(new Type[size]);
+        }
+    }
+
+    // Забирает буфер storage как массив Type. Объекты Type в буфере к этому моменту
+    // уже должны быть созданы вызывающим кодом (например, placement new): освобождение
+    // совпадает с выделением лишь потому, что оба типа хранятся в сырой памяти
+    template <typename Source>
+    static ArrayPtr FromStorage(ArrayPtr<Source>&& storage) noexcept {
+        static_assert(RAW_STORAGE && ArrayPtr<Source>::RAW_STORAGE);
+        void* const raw = storage.Release();
+        return ArrayPtr(raw != nullptr ? std::launder(static_cast<Type*>(raw)) : nullptr);
+    }
+
     // Удаляем у класса конструктор копирования
     ArrayPtr(const ArrayPtr&) = delete ;
     // Конструктор копирования для move
@@ -42,7 +80,12 @@ public:
 
     // Деструктор. Удаляет объект, на который ссылается умный указатель.
     ~ArrayPtr() {
-       delete [] ptr_;
+        if constexpr (RAW_STORAGE) {
+            ::operator delete[](ptr_);
+        }
+        else {
+            delete [] ptr_;
+        }
     }
 
     // Возвращает указатель, хранящийся внутри ArraydPtr
@@ -78,5 +121,12 @@ public:
     }
 
 private:
+    static Type* Allocate(std::size_t size) {
+        if (size > SIZE_MAX / sizeof(Type)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<Type*>(::operator new[](size * sizeof(Type)));
+    }
+
     Type* ptr_ = nullptr;
 };
\ No newline at end of file
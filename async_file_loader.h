@@ -0,0 +1,178 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "simple_vector.h"
+
+// Асинхронное чтение файла блоками фиксированного размера.
+// Фоновый поток заполняет несколько буферов SimpleVector<char>, пока потребитель
+// разбирает уже прочитанный блок. Буферы переиспользуются: Next обменивает
+// разобранный буфер потребителя на следующий заполненный, поэтому после
+// первого круга память больше не выделяется
+class AsyncFileLoader {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+    static constexpr size_t DEFAULT_BUFFER_COUNT = 2;
+
+    // Открывает файл и запускает фоновое чтение.
+    // Выбрасывает std::system_error, если файл не удалось открыть
+    explicit AsyncFileLoader(const std::string& path,
+                             size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                             size_t buffer_count = DEFAULT_BUFFER_COUNT)
+        : chunk_size_(chunk_size),
+        slots_(std::max<size_t>(buffer_count, 1))
+    {
+        // память выделяется до открытия файла: bad_alloc не оставит открытый дескриптор
+        for (auto& slot : slots_) {
+            slot.Reserve(chunk_size_);
+        }
+        free_count_ = slots_.GetSize();
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        try {
+            reader_ = std::thread([this] {
+                ReadLoop();
+            });
+        }
+        catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    AsyncFileLoader(const AsyncFileLoader&) = delete;
+    AsyncFileLoader& operator=(const AsyncFileLoader&) = delete;
+
+    ~AsyncFileLoader() {
+        {
+            std::lock_guard guard(mutex_);
+            stopped_ = true;
+        }
+        free_cv_.notify_one();
+        reader_.join();
+        ::close(fd_);
+    }
+
+    // Обменивает buffer на следующий прочитанный блок. Прежнее содержимое buffer
+    // возвращается загрузчику для повторного использования.
+    // Возвращает false, когда файл прочитан до конца.
+    // Выбрасывает std::system_error, если фоновое чтение завершилось ошибкой
+    bool Next(SimpleVector<char>& buffer) {
+        std::unique_lock lock(mutex_);
+        filled_cv_.wait(lock, [this] {
+            return filled_count_ > 0 || finished_;
+        });
+        if (filled_count_ == 0) {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return false;
+        }
+        SimpleVector<char>& filled = slots_[filled_head_];
+        filled.swap(buffer);
+        filled_head_ = (filled_head_ + 1) % slots_.GetSize();
+        --filled_count_;
+        // разобранный буфер занимает освободившийся слот
+        ++free_count_;
+        lock.unlock();
+        free_cv_.notify_one();
+        return true;
+    }
+
+private:
+    // Слоты образуют кольцо: заполненные блоки идут подряд от filled_head_,
+    // за ними — свободные буферы
+    void ReadLoop() {
+        size_t tail = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mutex_);
+                free_cv_.wait(lock, [this] {
+                    return free_count_ > 0 || stopped_;
+                });
+                if (stopped_) {
+                    return;
+                }
+                --free_count_;
+            }
+            // слот tail принадлежит только фоновому потоку, пока не будет опубликован
+            SimpleVector<char>& buffer = slots_[tail];
+            bool at_end = false;
+            try {
+                at_end = !ReadChunk(buffer);
+            }
+            catch (...) {
+                std::lock_guard guard(mutex_);
+                error_ = std::current_exception();
+                finished_ = true;
+                filled_cv_.notify_one();
+                return;
+            }
+            std::lock_guard guard(mutex_);
+            if (at_end) {
+                finished_ = true;
+                filled_cv_.notify_one();
+                return;
+            }
+            ++filled_count_;
+            tail = (tail + 1) % slots_.GetSize();
+            filled_cv_.notify_one();
+        }
+    }
+
+    // Читает до chunk_size_ байт в buffer. Возвращает false в конце файла
+    bool ReadChunk(SimpleVector<char>& buffer) {
+        // Размер уменьшается без заполнения, а увеличение до chunk_size_ заполняет
+        // только хвост короткого последнего блока, так что полные блоки не обнуляются
+        buffer.Resize(chunk_size_);
+        size_t total = 0;
+        while (total < chunk_size_) {
+            const ssize_t count = ::read(fd_, buffer.begin() + total, chunk_size_ - total);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "read failed");
+            }
+            if (count == 0) {
+                break;
+            }
+            total += static_cast<size_t>(count);
+        }
+        buffer.Resize(total);
+        return total > 0;
+    }
+
+    int fd_ = -1;
+    size_t chunk_size_;
+    SimpleVector<SimpleVector<char>> slots_;
+
+    std::mutex mutex_;
+    std::condition_variable filled_cv_;
+    std::condition_variable free_cv_;
+    size_t filled_head_ = 0;
+    size_t filled_count_ = 0;
+    size_t free_count_ = 0;
+    bool finished_ = false;
+    bool stopped_ = false;
+    std::exception_ptr error_;
+
+    std::thread reader_;
+};
@@ -0,0 +1,2001 @@
+﻿#include "simple_vector.h"
+#include "append_log.h"
+#include "async_file_loader.h"
+#include "byte_swap.h"
+#include "csv_parser.h"
+#include "deduplicate.h"
+#include "deterministic_sum.h"
+#include "group_by.h"
+#include "memory_reclaimer.h"
+#include "merge_k.h"
+#include "normalized_key_sort.h"
+#include "poly_vector.h"
+#include "prefix_sum_vector.h"
+#include "quantized_vector.h"
+#include "radix_partition.h"
+#include "rle_vector.h"
+#include "roaring_bitmap.h"
+#include "sort_tracking_vector.h"
+#include "string_builder.h"
+#include "vector_latency.h"
+#include "vector_search.h"
+#include "vector_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+// Учёт живой памяти без заголовков в блоках: размер блока при освобождении
+// берётся из malloc_usable_size, поэтому считаются полезные размеры блоков malloc
+// (без glibc байты не считаются, только число выделений). Каждый поток пишет
+// в собственные счётчики на отдельной кэш-линии, а суммы собираются при чтении,
+// так что многопоточный soak не упирается в общие атомарные переменные.
+// Пик отслеживается для живой памяти вызывающего потока: его меряют только
+// однопоточные бенчмарки, а soak берёт максимум из ежесекундных выборок.
+// Заменены и перегрузки с std::align_val_t, а nothrow-перегрузки libstdc++
+// вызывают заменённые, так что учитываются выделения для любых типов
+namespace memory_stats {
+
+struct alignas(64) ThreadCounters {
+    atomic<size_t> allocated_bytes{0};
+    atomic<size_t> freed_bytes{0};
+    atomic<size_t> allocations{0};
+};
+
+// Потоки сверх MAX_THREADS делят последний набор счётчиков
+constexpr size_t MAX_THREADS = 256;
+
+ThreadCounters thread_counters[MAX_THREADS];
+atomic<size_t> threads_registered{0};
+
+struct ThreadState {
+    ThreadCounters* counters = nullptr;
+    // Живая память потока; уходит в минус, если поток освобождает чужие блоки
+    int64_t live = 0;
+    int64_t peak = 0;
+    int64_t peak_base = 0;
+};
+
+thread_local ThreadState thread_state;
+
+size_t BlockSize([[maybe_unused]] void* ptr) noexcept {
+#ifdef __GLIBC__
+    return malloc_usable_size(ptr);
+#else
+    return 0;
+#endif
+}
+
+ThreadCounters& GetThreadCounters() noexcept {
+    ThreadState& state = thread_state;
+    if (!state.counters) {
+        const size_t index = threads_registered.fetch_add(1, memory_order_relaxed);
+        state.counters = &thread_counters[min(index, MAX_THREADS - 1)];
+    }
+    return *state.counters;
+}
+
+// alignment — выравнивание перегрузок с std::align_val_t, 0 для обычных
+void* Allocate(size_t size, size_t alignment = 0) {
+    // aligned_alloc требует размер, кратный выравниванию
+    void* ptr = alignment == 0 ? malloc(size)
+                               : aligned_alloc(alignment, (max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+    if (!ptr) {
+        throw bad_alloc();
+    }
+    const size_t bytes = BlockSize(ptr);
+    ThreadCounters& counters = GetThreadCounters();
+    // кэш-линия своя, поэтому fetch_add не конкурирует с другими потоками
+    counters.allocated_bytes.fetch_add(bytes, memory_order_relaxed);
+    counters.allocations.fetch_add(1, memory_order_relaxed);
+    ThreadState& state = thread_state;
+    state.live += static_cast<int64_t>(bytes);
+    state.peak = max(state.peak, state.live);
+    return ptr;
+}
+
+void Deallocate(void* ptr) noexcept {
+    if (ptr) {
+        const size_t bytes = BlockSize(ptr);
+        GetThreadCounters().freed_bytes.fetch_add(bytes, memory_order_relaxed);
+        thread_state.live -= static_cast<int64_t>(bytes);
+        free(ptr);
+    }
+}
+
+size_t GetRegisteredCount() {
+    return min(threads_registered.load(memory_order_relaxed), MAX_THREADS);
+}
+
+// Живая память всех потоков
+size_t GetLiveBytes() {
+    size_t allocated = 0;
+    size_t freed = 0;
+    for (size_t i = 0; i < GetRegisteredCount(); ++i) {
+        freed += thread_counters[i].freed_bytes.load(memory_order_relaxed);
+        allocated += thread_counters[i].allocated_bytes.load(memory_order_relaxed);
+    }
+    // освобождение может попасть в сумму раньше парного выделения
+    return allocated > freed ? allocated - freed : 0;
+}
+
+size_t GetAllocations() {
+    size_t allocations = 0;
+    for (size_t i = 0; i < GetRegisteredCount(); ++i) {
+        allocations += thread_counters[i].allocations.load(memory_order_relaxed);
+    }
+    return allocations;
+}
+
+// Начинает отсчёт пика живой памяти вызывающего потока
+void ResetPeak() {
+    ThreadState& state = thread_state;
+    state.peak = state.live;
+    state.peak_base = state.live;
+}
+
+// На сколько живая память вызывающего потока поднималась над уровнем при ResetPeak
+size_t GetPeakGrowth() {
+    const ThreadState& state = thread_state;
+    return static_cast<size_t>(state.peak - state.peak_base);
+}
+
+// Резидентная память процесса в байтах, 0 если /proc недоступен
+size_t GetRss() {
+    ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+}  // namespace memory_stats
+
+void* operator new(size_t size) {
+    return memory_stats::Allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return memory_stats::Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+// Выделения для типов с повышенным выравниванием тоже учитываются
+void* operator new(size_t size, align_val_t alignment) {
+    return memory_stats::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    return memory_stats::Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr, align_val_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, align_val_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t, align_val_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t, align_val_t) noexcept {
+    memory_stats::Deallocate(ptr);
+}
+
+class Timer {
+public:
+    double GetSeconds() const {
+        return chrono::duration<double>(chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    chrono::steady_clock::time_point start_ = chrono::steady_clock::now();
+};
+
+double ToMiB(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+size_t ParseArg(const vector<string>& args, size_t index, size_t default_value) {
+    return index < args.size() ? stoul(args[index]) : default_value;
+}
+
+// ---------------------------------------------------------------------------
+// soak [seconds] [threads]
+//
+// Длительная смешанная нагрузка: векторы разных размеров и типов растут,
+// сжимаются, очищаются и уничтожаются в нескольких потоках. Раз в секунду
+// печатается строка со значениями RSS, живой и пиковой памяти и статистикой
+// аллокатора, по которой можно судить о фрагментации при данной политике роста
+
+// Размер, распределённый логарифмически от 1 до 2^max_log
+size_t RandomSize(mt19937_64& rng, int max_log) {
+    uniform_int_distribution<int> log_dist(0, max_log);
+    const size_t upper = size_t{1} << log_dist(rng);
+    return uniform_int_distribution<size_t>(1, upper)(rng);
+}
+
+template <typename Type>
+void SoakStep(SimpleVector<SimpleVector<Type>>& pool, mt19937_64& rng) {
+    auto& v = pool[uniform_int_distribution<size_t>(0, pool.GetSize() - 1)(rng)];
+    switch (uniform_int_distribution<int>(0, 9)(rng)) {
+    case 0:
+    case 1:
+    case 2: {
+        // рост через PushBack
+        const size_t count = RandomSize(rng, 12);
+        for (size_t i = 0; i < count; ++i) {
+            v.PushBack(static_cast<Type>(i));
+        }
+        break;
+    }
+    case 3:
+        v.Resize(RandomSize(rng, 16));
+        break;
+    case 4:
+        v.Resize(v.GetSize() / 2);
+        break;
+    case 5:
+        v.Clear();
+        break;
+    case 6:
+        v.Reserve(v.GetCapacity() + RandomSize(rng, 14));
+        break;
+    case 7:
+        // пересоздание: освобождает большую вместимость
+        v = SimpleVector<Type>(RandomSize(rng, 10));
+        break;
+    case 8:
+        if (!v.IsEmpty()) {
+            v.Erase(v.begin() + uniform_int_distribution<size_t>(0, v.GetSize() - 1)(rng));
+        }
+        break;
+    default:
+        v.Insert(v.begin() + (v.IsEmpty() ? 0 : v.GetSize() / 2), Type());
+        break;
+    }
+}
+
+void SoakWorker(const atomic<bool>& stop, uint64_t seed, atomic<uint64_t>& operations) {
+    mt19937_64 rng(seed);
+    SimpleVector<SimpleVector<char>> bytes(64);
+    SimpleVector<SimpleVector<int>> ints(64);
+    SimpleVector<SimpleVector<uint64_t>> words(32);
+    while (!stop.load(memory_order_relaxed)) {
+        for (int i = 0; i < 64; ++i) {
+            switch (i % 3) {
+            case 0:
+                SoakStep(bytes, rng);
+                break;
+            case 1:
+                SoakStep(ints, rng);
+                break;
+            default:
+                SoakStep(words, rng);
+                break;
+            }
+        }
+        operations.fetch_add(64, memory_order_relaxed);
+    }
+}
+
+// Пик — максимум живой памяти по выборкам: точный пик потребовал бы
+// общего счётчика в каждом выделении
+void PrintSoakSample(double seconds, uint64_t operations, size_t& peak) {
+    const size_t live = memory_stats::GetLiveBytes();
+    peak = max(peak, live);
+    const size_t rss = memory_stats::GetRss();
+    cout << fixed << setprecision(1) << seconds
+         << ',' << operations
+         << ',' << setprecision(2) << ToMiB(rss)
+         << ',' << ToMiB(live)
+         << ',' << ToMiB(peak)
+         << ',' << (live ? static_cast<double>(peak) / live : 0.0)
+         << ',' << (live ? static_cast<double>(rss) / live : 0.0);
+#ifdef __GLIBC__
+    const struct mallinfo2 info = mallinfo2();
+    cout << ',' << ToMiB(info.uordblks) << ',' << ToMiB(info.fordblks) << ',' << ToMiB(info.hblkhd);
+#else
+    cout << ",,,";
+#endif
+    cout << endl;
+}
+
+void BenchmarkSoak(const vector<string>& args) {
+    const size_t seconds = ParseArg(args, 0, 300);
+    const size_t threads = ParseArg(args, 1, max(1u, thread::hardware_concurrency()));
+    cout << "soak: " << seconds << " s, " << threads << " threads" << endl;
+    cout << "time_s,operations,rss_mib,live_mib,peak_mib,peak_to_live,rss_to_live,"
+            "heap_in_use_mib,heap_free_mib,mmap_mib" << endl;
+
+    size_t peak = 0;
+    atomic<bool> stop{false};
+    atomic<uint64_t> operations{0};
+    vector<thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(SoakWorker, cref(stop), 12345 + i, ref(operations));
+    }
+
+    Timer timer;
+    while (timer.GetSeconds() < seconds) {
+        this_thread::sleep_for(chrono::seconds(1));
+        PrintSoakSample(timer.GetSeconds(), operations.load(memory_order_relaxed), peak);
+    }
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    cout << "after teardown:" << endl;
+    PrintSoakSample(timer.GetSeconds(), operations.load(memory_order_relaxed), peak);
+}
+
+// ---------------------------------------------------------------------------
+// replay <trace-file>
+//
+// Повторяет трассу, записанную vector_trace::Recorder, на SimpleVector,
+// std::vector и std::deque и сравнивает время, пиковую память и число выделений.
+// Адреса векторов из трассы заранее заменяются на плотные номера слотов,
+// чтобы поиск контейнера не входил в измеряемое время
+
+struct ReplayOp {
+    vector_trace::Op op;
+    uint32_t slot;
+    // для операций с другим вектором — номер его слота
+    uint64_t arg;
+};
+
+struct ReplayTrace {
+    vector<ReplayOp> ops;
+    size_t slot_count = 0;
+};
+
+optional<ReplayTrace> LoadTrace(const string& path) {
+    using vector_trace::Op;
+    vector_trace::Reader reader(path);
+    if (!reader) {
+        return nullopt;
+    }
+    ReplayTrace trace;
+    unordered_map<uint64_t, uint32_t> live_slots;
+    // Вектор, созданный до начала записи, появляется в трассе без Construct
+    auto slot_of = [&](uint64_t id) {
+        auto [it, inserted] = live_slots.try_emplace(id, static_cast<uint32_t>(trace.slot_count));
+        if (inserted) {
+            ++trace.slot_count;
+        }
+        return it->second;
+    };
+    vector_trace::Record record;
+    while (reader.Next(record)) {
+        ReplayOp op{record.op, 0, record.arg};
+        if (vector_trace::HasVectorArgument(record.op)) {
+            op.arg = slot_of(record.arg);
+        }
+        switch (record.op) {
+        case Op::Construct:
+        case Op::CopyConstruct:
+        case Op::MoveConstruct:
+            live_slots.erase(record.id);
+            op.slot = slot_of(record.id);
+            break;
+        case Op::Destroy: {
+            auto it = live_slots.find(record.id);
+            if (it == live_slots.end()) {
+                continue;
+            }
+            op.slot = it->second;
+            live_slots.erase(it);
+            break;
+        }
+        default:
+            op.slot = slot_of(record.id);
+            break;
+        }
+        trace.ops.push_back(op);
+    }
+    return trace;
+}
+
+// Адаптеры операций: у SimpleVector и стандартных контейнеров разные имена методов
+template <typename Type>
+void TracePushBack(SimpleVector<Type>& v) {
+    v.PushBack(Type());
+}
+
+template <typename Container>
+void TracePushBack(Container& c) {
+    c.push_back(typename Container::value_type());
+}
+
+template <typename Type>
+void TraceInsert(SimpleVector<Type>& v, size_t index) {
+    v.Insert(v.begin() + min(index, v.GetSize()), Type());
+}
+
+template <typename Container>
+void TraceInsert(Container& c, size_t index) {
+    c.insert(c.begin() + min(index, c.size()), typename Container::value_type());
+}
+
+template <typename Type>
+void TraceErase(SimpleVector<Type>& v, size_t index) {
+    if (index < v.GetSize()) {
+        v.Erase(v.begin() + index);
+    }
+}
+
+template <typename Container>
+void TraceErase(Container& c, size_t index) {
+    if (index < c.size()) {
+        c.erase(c.begin() + index);
+    }
+}
+
+template <typename Type>
+void TraceResize(SimpleVector<Type>& v, size_t size) {
+    v.Resize(size);
+}
+
+template <typename Container>
+void TraceResize(Container& c, size_t size) {
+    c.resize(size);
+}
+
+template <typename Type>
+void TraceReserve(SimpleVector<Type>& v, size_t capacity) {
+    v.Reserve(capacity);
+}
+
+template <typename Container>
+void TraceReserve(Container& c, size_t capacity) {
+    // у std::deque нет reserve
+    if constexpr (requires { c.reserve(capacity); }) {
+        c.reserve(capacity);
+    }
+}
+
+template <typename Type>
+void TracePopBack(SimpleVector<Type>& v) {
+    if (!v.IsEmpty()) {
+        v.PopBack();
+    }
+}
+
+template <typename Container>
+void TracePopBack(Container& c) {
+    if (!c.empty()) {
+        c.pop_back();
+    }
+}
+
+template <typename Type>
+void TraceClear(SimpleVector<Type>& v) {
+    v.Clear();
+}
+
+template <typename Container>
+void TraceClear(Container& c) {
+    c.clear();
+}
+
+template <typename Type>
+void TraceShrinkToFit(SimpleVector<Type>& v) {
+    v.ShrinkToFit();
+}
+
+template <typename Container>
+void TraceShrinkToFit(Container& c) {
+    c.shrink_to_fit();
+}
+
+template <typename Container>
+void ReplayOnce(const ReplayTrace& trace) {
+    using vector_trace::Op;
+    vector<optional<Container>> slots(trace.slot_count);
+    auto get = [&slots](size_t slot) -> Container& {
+        if (!slots[slot]) {
+            slots[slot].emplace();
+        }
+        return *slots[slot];
+    };
+    for (const ReplayOp& op : trace.ops) {
+        switch (op.op) {
+        case Op::Construct:
+            slots[op.slot].emplace(op.arg);
+            break;
+        case Op::CopyConstruct:
+            slots[op.slot].emplace(get(op.arg));
+            break;
+        case Op::MoveConstruct:
+            slots[op.slot].emplace(move(get(op.arg)));
+            break;
+        case Op::MoveAssign:
+            get(op.slot) = move(get(op.arg));
+            break;
+        case Op::Destroy:
+            slots[op.slot].reset();
+            break;
+        case Op::PushBack:
+            TracePushBack(get(op.slot));
+            break;
+        case Op::Insert:
+            TraceInsert(get(op.slot), op.arg);
+            break;
+        case Op::Erase:
+            TraceErase(get(op.slot), op.arg);
+            break;
+        case Op::Resize:
+            TraceResize(get(op.slot), op.arg);
+            break;
+        case Op::Reserve:
+            TraceReserve(get(op.slot), op.arg);
+            break;
+        case Op::PopBack:
+            TracePopBack(get(op.slot));
+            break;
+        case Op::Clear:
+            TraceClear(get(op.slot));
+            break;
+        case Op::Swap:
+            swap(get(op.slot), get(op.arg));
+            break;
+        case Op::ShrinkToFit:
+            TraceShrinkToFit(get(op.slot));
+            break;
+        }
+    }
+}
+
+template <typename Container>
+void ReplayAndReport(string_view name, const ReplayTrace& trace) {
+    memory_stats::ResetPeak();
+    const size_t base_allocations = memory_stats::GetAllocations();
+    Timer timer;
+    ReplayOnce<Container>(trace);
+    const double seconds = timer.GetSeconds();
+    cout << setw(24) << left << name << right
+         << fixed << setprecision(2) << setw(10) << seconds * 1000 << " ms"
+         << setw(12) << ToMiB(memory_stats::GetPeakGrowth()) << " MiB peak"
+         << setw(12) << memory_stats::GetAllocations() - base_allocations
+         << " allocations" << endl;
+}
+
+void BenchmarkReplay(const vector<string>& args) {
+    if (args.empty()) {
+        cerr << "usage: benchmark replay <trace-file>" << endl;
+        return;
+    }
+    const optional<ReplayTrace> trace = LoadTrace(args[0]);
+    if (!trace) {
+        cerr << "cannot read trace " << args[0] << endl;
+        return;
+    }
+    cout << "replay: " << trace->ops.size() << " operations on " << trace->slot_count << " vectors" << endl;
+    ReplayAndReport<SimpleVector<int64_t>>("SimpleVector<int64_t>", *trace);
+    ReplayAndReport<vector<int64_t>>("std::vector<int64_t>", *trace);
+    ReplayAndReport<deque<int64_t>>("std::deque<int64_t>", *trace);
+}
+
+// ---------------------------------------------------------------------------
+// latency [count]
+//
+// Стоимость выборочных измерений: PushBack в цикле с SampleScope при разных частотах
+// выборки и без него, затем распределение задержек при измерении каждой операции
+
+template <bool Sampled>
+double PushBackLoop(size_t count) {
+    Timer timer;
+    for (int round = 0; round < 10; ++round) {
+        SimpleVector<int> v;
+        for (size_t i = 0; i < count; ++i) {
+            if constexpr (Sampled) {
+                vector_latency::SampleScope scope(vector_latency::Op::PushBack);
+                v.PushBack(static_cast<int>(i));
+            }
+            else {
+                v.PushBack(static_cast<int>(i));
+            }
+        }
+    }
+    return timer.GetSeconds() * 1e9 / (10.0 * count);
+}
+
+void BenchmarkLatency(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 1000000);
+    cout << "latency: PushBack x " << count << endl;
+    cout << "  without instrumentation: " << fixed << setprecision(2) << PushBackLoop<false>(count) << " ns/op" << endl;
+    for (const uint32_t rate : {0u, 1000u, 100u, 1u}) {
+        vector_latency::SetSamplingRate(rate);
+        cout << "  sampling 1/" << rate << ": " << PushBackLoop<true>(count) << " ns/op" << endl;
+    }
+    vector_latency::SetSamplingRate(0);
+    vector_latency::Dump(cout);
+    vector_latency::Reset();
+}
+
+// ---------------------------------------------------------------------------
+// loader [MiB] [chunk-KiB] [buffers]
+//
+// Чтение и разбор файла: синхронно блоками в один SimpleVector<char>
+// и через AsyncFileLoader, где чтение следующего блока идёт во время разбора.
+// Файл создаётся во временном каталоге и, скорее всего, лежит в page cache,
+// так что результат показывает выигрыш от совмещения копирования и разбора
+
+// Разбор блока: число строк и хеш FNV-1a содержимого
+struct ParseResult {
+    size_t lines = 0;
+    uint64_t hash = 14695981039346656037ull;
+};
+
+void ParseChunk(const SimpleVector<char>& chunk, ParseResult& result) {
+    for (const char c : chunk) {
+        result.lines += c == '\n';
+        result.hash = (result.hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+}
+
+ParseResult ParseSync(const string& path, size_t chunk_size) {
+    ParseResult result;
+    const int fd = open(path.c_str(), O_RDONLY);
+    SimpleVector<char> buffer(chunk_size);
+    while (true) {
+        buffer.Resize(chunk_size);
+        const ssize_t count = read(fd, buffer.begin(), chunk_size);
+        if (count <= 0) {
+            break;
+        }
+        buffer.Resize(static_cast<size_t>(count));
+        ParseChunk(buffer, result);
+    }
+    close(fd);
+    return result;
+}
+
+ParseResult ParseAsync(const string& path, size_t chunk_size, size_t buffers) {
+    ParseResult result;
+    AsyncFileLoader loader(path, chunk_size, buffers);
+    SimpleVector<char> buffer;
+    while (loader.Next(buffer)) {
+        ParseChunk(buffer, result);
+    }
+    return result;
+}
+
+void BenchmarkLoader(const vector<string>& args) {
+    const size_t mib = ParseArg(args, 0, 256);
+    const size_t chunk_size = ParseArg(args, 1, 1024) * 1024;
+    const size_t buffers = ParseArg(args, 2, 2);
+    const string path = (filesystem::temp_directory_path() / "simple_vector_loader_bench.txt").string();
+    {
+        ofstream out(path, ios::binary);
+        string line = "0123456789,abcdefghij,0.25,-17\n";
+        for (size_t written = 0; written < mib * 1024 * 1024; written += line.size()) {
+            out << line;
+        }
+    }
+    cout << "loader: " << mib << " MiB, chunk " << chunk_size / 1024 << " KiB, " << buffers << " buffers" << endl;
+    for (int round = 0; round < 2; ++round) {
+        Timer sync_timer;
+        const ParseResult sync = ParseSync(path, chunk_size);
+        const double sync_seconds = sync_timer.GetSeconds();
+        Timer async_timer;
+        const ParseResult async = ParseAsync(path, chunk_size, buffers);
+        const double async_seconds = async_timer.GetSeconds();
+        if (sync.lines != async.lines || sync.hash != async.hash) {
+            cerr << "loader: results differ" << endl;
+        }
+        cout << fixed << setprecision(1)
+             << "  sync:  " << setw(8) << mib / sync_seconds << " MiB/s" << endl
+             << "  async: " << setw(8) << mib / async_seconds << " MiB/s" << endl;
+    }
+    filesystem::remove(path);
+}
+
+// ---------------------------------------------------------------------------
+// csv [rows]
+//
+// Разбор CSV из трёх столбцов (int64, double, int64): посимвольный цикл
+// со strtoll/strtod и PushBack каждого значения против CsvColumns
+
+struct NaiveColumns {
+    SimpleVector<int64_t> first;
+    SimpleVector<double> second;
+    SimpleVector<int64_t> third;
+};
+
+NaiveColumns ParseCsvNaive(const string& text) {
+    NaiveColumns columns;
+    string field;
+    int column = 0;
+    for (const char c : text) {
+        if (c == ',' || c == '\n') {
+            switch (column) {
+            case 0:
+                columns.first.PushBack(strtoll(field.c_str(), nullptr, 10));
+                break;
+            case 1:
+                columns.second.PushBack(strtod(field.c_str(), nullptr));
+                break;
+            default:
+                columns.third.PushBack(strtoll(field.c_str(), nullptr, 10));
+                break;
+            }
+            field.clear();
+            column = c == '\n' ? 0 : column + 1;
+        }
+        else {
+            field += c;
+        }
+    }
+    return columns;
+}
+
+void BenchmarkCsv(const vector<string>& args) {
+    const size_t rows = ParseArg(args, 0, 2000000);
+    mt19937_64 rng(42);
+    string text;
+    for (size_t i = 0; i < rows; ++i) {
+        text += to_string(static_cast<int64_t>(rng() % 2000000000) - 1000000000);
+        text += ',';
+        text += to_string(static_cast<double>(rng() % 1000000) / 1024.0);
+        text += ',';
+        text += to_string(rng() % 100000);
+        text += '\n';
+    }
+    const double mib = ToMiB(text.size());
+    cout << "csv: " << rows << " rows, " << fixed << setprecision(1) << mib << " MiB" << endl;
+
+    Timer naive_timer;
+    const NaiveColumns naive = ParseCsvNaive(text);
+    const double naive_seconds = naive_timer.GetSeconds();
+
+    Timer columns_timer;
+    CsvColumns csv{ColumnType::Int64, ColumnType::Double, ColumnType::Int64};
+    csv.Append(text);
+    const double columns_seconds = columns_timer.GetSeconds();
+
+    if (csv.GetInt64Column(0) != naive.first || csv.GetInt64Column(2) != naive.third
+        || csv.GetRowCount() != naive.second.GetSize()) {
+        cerr << "csv: results differ" << endl;
+    }
+    cout << "  naive:      " << setw(8) << mib / naive_seconds << " MiB/s" << endl;
+    cout << "  CsvColumns: " << setw(8) << mib / columns_seconds << " MiB/s" << endl;
+}
+
+// ---------------------------------------------------------------------------
+// string-builder [messages]
+//
+// Сборка сообщений вида "id=<int> value=<double> name=<string>\n" и копирование
+// результата в SimpleVector<char>: std::ostringstream, std::string с to_string и StringBuilder
+
+template <typename Build>
+void MeasureBuilder(string_view name, size_t messages, Build build) {
+    Timer timer;
+    const SimpleVector<char> result = build();
+    const double seconds = timer.GetSeconds();
+    cout << "  " << setw(14) << left << name << right << fixed << setprecision(1)
+         << setw(8) << seconds * 1e9 / messages << " ns/message, " << ToMiB(result.GetSize()) << " MiB" << endl;
+}
+
+SimpleVector<char> ToCharVector(const string& text) {
+    SimpleVector<char> result(text.size());
+    copy(text.begin(), text.end(), result.begin());
+    return result;
+}
+
+void BenchmarkStringBuilder(const vector<string>& args) {
+    const size_t messages = ParseArg(args, 0, 1000000);
+    const string name = "simple_vector";
+    cout << "string-builder: " << messages << " messages" << endl;
+
+    MeasureBuilder("ostringstream", messages, [&] {
+        ostringstream out;
+        for (size_t i = 0; i < messages; ++i) {
+            out << "id=" << i << " value=" << i * 0.37 << " name=" << name << '\n';
+        }
+        return ToCharVector(out.str());
+    });
+    MeasureBuilder("std::string", messages, [&] {
+        string out;
+        for (size_t i = 0; i < messages; ++i) {
+            out += "id=" + to_string(i) + " value=" + to_string(i * 0.37) + " name=" + name + '\n';
+        }
+        return ToCharVector(out);
+    });
+    MeasureBuilder("StringBuilder", messages, [&] {
+        StringBuilder out;
+        for (size_t i = 0; i < messages; ++i) {
+            out << "id=" << i << " value=" << i * 0.37 << " name=" << name << '\n';
+        }
+        return out.Release();
+    });
+}
+
+// ---------------------------------------------------------------------------
+// byteswap [MiB]
+//
+// Загрузка big-endian данных в SimpleVector<uint32_t> и SimpleVector<uint64_t>:
+// копирование и скалярный проход с __builtin_bswap (автовекторизация выключена)
+// против AppendBigEndian, а также перестановка на месте
+
+template <typename Type>
+[[gnu::optimize("no-tree-vectorize")]] void ScalarLoadBigEndian(const SimpleVector<char>& bytes, SimpleVector<Type>& items) {
+    const size_t count = bytes.GetSize() / sizeof(Type);
+    items.Resize(count);
+    memcpy(items.begin(), bytes.begin(), count * sizeof(Type));
+    for (Type& item : items) {
+        item = byte_swap_detail::ByteSwapValue(item);
+    }
+}
+
+template <typename Type>
+void MeasureByteSwap(string_view name, const SimpleVector<char>& bytes) {
+    const double mib = ToMiB(bytes.GetSize());
+    SimpleVector<Type> scalar;
+    SimpleVector<Type> kernel;
+    // первый проход выделяет память, измеряется второй
+    ScalarLoadBigEndian(bytes, scalar);
+    AppendBigEndian(bytes, kernel);
+
+    Timer scalar_timer;
+    ScalarLoadBigEndian(bytes, scalar);
+    const double scalar_seconds = scalar_timer.GetSeconds();
+
+    kernel.Clear();
+    Timer kernel_timer;
+    AppendBigEndian(bytes, kernel);
+    const double kernel_seconds = kernel_timer.GetSeconds();
+
+    Timer in_place_timer;
+    ByteSwapInPlace(kernel);
+    const double in_place_seconds = in_place_timer.GetSeconds();
+    ByteSwapInPlace(kernel);
+
+    if (scalar != kernel) {
+        cerr << "byteswap: results differ" << endl;
+    }
+    cout << "  " << name << fixed << setprecision(0)
+         << ": scalar load " << setw(6) << mib / scalar_seconds << " MiB/s"
+         << ", AppendBigEndian " << setw(6) << mib / kernel_seconds << " MiB/s"
+         << ", in place " << setw(6) << mib / in_place_seconds << " MiB/s" << endl;
+}
+
+void BenchmarkByteSwap(const vector<string>& args) {
+    const size_t mib = ParseArg(args, 0, 256);
+    SimpleVector<char> bytes(mib * 1024 * 1024);
+    mt19937_64 rng(7);
+    for (char& byte : bytes) {
+        byte = static_cast<char>(rng());
+    }
+    cout << "byteswap: " << mib << " MiB" << endl;
+    MeasureByteSwap<uint32_t>("uint32_t", bytes);
+    MeasureByteSwap<uint64_t>("uint64_t", bytes);
+}
+
+// ---------------------------------------------------------------------------
+// poly [objects]
+//
+// Заполнение и обход с виртуальным вызовом на каждом элементе:
+// SimpleVector<unique_ptr<Base>> против PolyVector<Base>. Между объектами
+// в куче выделяются и частично освобождаются посторонние блоки, как в живой программе
+
+struct PolyShape {
+    virtual ~PolyShape() = default;
+    virtual double Area() const = 0;
+};
+
+struct PolyCircle : PolyShape {
+    explicit PolyCircle(double radius)
+        : radius(radius)
+    {
+    }
+    double Area() const override {
+        return 3.14159265358979 * radius * radius;
+    }
+    double radius;
+};
+
+struct PolyRect : PolyShape {
+    PolyRect(double width, double height)
+        : width(width),
+        height(height)
+    {
+    }
+    double Area() const override {
+        return width * height;
+    }
+    double width;
+    double height;
+};
+
+struct PolyTriangle : PolyShape {
+    PolyTriangle(double a, double b, double c)
+        : a(a),
+        b(b),
+        c(c)
+    {
+    }
+    double Area() const override {
+        const double p = (a + b + c) / 2;
+        return p * (p - a) * (p - b) * (p - c);
+    }
+    double a;
+    double b;
+    double c;
+};
+
+// Фигуры не владеют ресурсами, поэтому PolyVector переносит их одним memcpy
+template <>
+inline constexpr bool IS_TRIVIALLY_RELOCATABLE<PolyCircle> = true;
+template <>
+inline constexpr bool IS_TRIVIALLY_RELOCATABLE<PolyRect> = true;
+template <>
+inline constexpr bool IS_TRIVIALLY_RELOCATABLE<PolyTriangle> = true;
+
+template <typename Add>
+void FillShapes(size_t objects, Add add) {
+    for (size_t i = 0; i < objects; ++i) {
+        const double x = static_cast<double>(i % 100) + 1;
+        switch (i % 3) {
+        case 0:
+            add(PolyCircle(x));
+            break;
+        case 1:
+            add(PolyRect(x, x + 1));
+            break;
+        default:
+            add(PolyTriangle(x, x, x));
+            break;
+        }
+    }
+}
+
+template <typename Shapes>
+double SumAreas(const Shapes& shapes) {
+    double total = 0;
+    for (const auto& shape : shapes) {
+        if constexpr (is_same_v<decay_t<decltype(shape)>, PolyShape>) {
+            total += shape.Area();
+        }
+        else {
+            total += shape->Area();
+        }
+    }
+    return total;
+}
+
+template <typename Shapes>
+void MeasurePasses(string_view name, const Shapes& shapes, double fill_seconds, size_t objects) {
+    constexpr int passes = 10;
+    double total = 0;
+    Timer timer;
+    for (int pass = 0; pass < passes; ++pass) {
+        total += SumAreas(shapes);
+    }
+    const double seconds = timer.GetSeconds();
+    cout << "  " << setw(12) << left << name << right << fixed << setprecision(2)
+         << "fill " << setw(6) << fill_seconds * 1e9 / objects << " ns/object, iterate "
+         << setw(6) << seconds * 1e9 / (passes * objects) << " ns/object"
+         << " (checksum " << setprecision(0) << total << ')' << endl;
+}
+
+void BenchmarkPoly(const vector<string>& args) {
+    const size_t objects = ParseArg(args, 0, 1000000);
+    cout << "poly: " << objects << " objects" << endl;
+    {
+        mt19937 rng(11);
+        SimpleVector<unique_ptr<PolyShape>> shapes;
+        vector<unique_ptr<char[]>> noise;
+        const size_t allocations_before = memory_stats::GetAllocations();
+        Timer timer;
+        FillShapes(objects, [&](auto&& shape) {
+            using Shape = decay_t<decltype(shape)>;
+            shapes.PushBack(make_unique<Shape>(shape));
+            noise.push_back(make_unique<char[]>(16 + rng() % 64));
+            if (rng() % 2) {
+                noise.pop_back();
+            }
+        });
+        const double seconds = timer.GetSeconds();
+        MeasurePasses("unique_ptr", shapes, seconds, objects);
+        cout << "    allocations: " << memory_stats::GetAllocations() - allocations_before << endl;
+    }
+    {
+        PolyVector<PolyShape> shapes;
+        const size_t allocations_before = memory_stats::GetAllocations();
+        Timer timer;
+        FillShapes(objects, [&](auto&& shape) {
+            shapes.EmplaceBack<decay_t<decltype(shape)>>(shape);
+        });
+        const double seconds = timer.GetSeconds();
+        MeasurePasses("PolyVector", shapes, seconds, objects);
+        cout << "    allocations: " << memory_stats::GetAllocations() - allocations_before
+             << ", buffer " << setprecision(1) << ToMiB(shapes.GetBytesUsed()) << " MiB" << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// prefix-sum [size] [operations]
+//
+// Чередование изменения элемента и запроса суммы префикса: пересчёт массива
+// префиксных сумм после каждого изменения против PrefixSumVector, а также
+// построение дерева за O(n) против n вызовов PushBack
+
+void BenchmarkPrefixSum(const vector<string>& args) {
+    const size_t size = ParseArg(args, 0, 1 << 20);
+    const size_t operations = ParseArg(args, 1, 1000000);
+    // пересчёт стоит O(size) на изменение, поэтому для него операций меньше
+    const size_t naive_operations = max<size_t>(operations / 1000, 1);
+    cout << "prefix-sum: " << size << " elements, " << operations << " operations" << endl;
+
+    mt19937_64 rng(3);
+    SimpleVector<int64_t> values(size);
+    for (int64_t& value : values) {
+        value = static_cast<int64_t>(rng() % 1000);
+    }
+
+    int64_t checksum = 0;
+    {
+        SimpleVector<int64_t> data = values;
+        SimpleVector<int64_t> prefix(size + 1);
+        Timer timer;
+        for (size_t op = 0; op < naive_operations; ++op) {
+            data[rng() % size] = static_cast<int64_t>(rng() % 1000);
+            for (size_t i = 0; i < size; ++i) {
+                prefix[i + 1] = prefix[i] + data[i];
+            }
+            checksum += prefix[rng() % (size + 1)];
+        }
+        const double seconds = timer.GetSeconds();
+        cout << "  recompute       " << fixed << setprecision(1) << setw(10)
+             << seconds * 1e9 / naive_operations << " ns/operation" << endl;
+    }
+    {
+        Timer build_timer;
+        PrefixSumVector<int64_t> sums(values);
+        const double build_seconds = build_timer.GetSeconds();
+
+        Timer push_timer;
+        PrefixSumVector<int64_t> pushed;
+        pushed.Reserve(size);
+        for (const int64_t value : values) {
+            pushed.PushBack(value);
+        }
+        const double push_seconds = push_timer.GetSeconds();
+
+        Timer timer;
+        for (size_t op = 0; op < operations; ++op) {
+            sums.Set(rng() % size, static_cast<int64_t>(rng() % 1000));
+            checksum += sums.PrefixSum(rng() % (size + 1));
+            checksum += static_cast<int64_t>(sums.LowerBound(static_cast<int64_t>(rng() % 1000) * size / 2));
+        }
+        const double seconds = timer.GetSeconds();
+        cout << "  PrefixSumVector " << fixed << setprecision(1) << setw(10)
+             << seconds * 1e9 / operations << " ns/operation (update, prefix sum and lower bound)" << endl
+             << "  build " << setprecision(2) << build_seconds * 1e3 << " ms, PushBack "
+             << push_seconds * 1e3 << " ms" << endl;
+    }
+    cout << "  checksum " << checksum << endl;
+}
+
+// ---------------------------------------------------------------------------
+// roaring [values]
+//
+// Пересечение двух множеств uint32_t разной плотности: std::set_intersection
+// над отсортированными SimpleVector против And над RoaringBitmap, и занимаемая память
+
+SimpleVector<uint32_t> MakeSortedIds(mt19937_64& rng, size_t count, uint64_t universe, bool runs) {
+    vector<uint32_t> ids;
+    ids.reserve(count);
+    while (ids.size() < count) {
+        if (runs) {
+            // отрезки по 1000 значений
+            const uint32_t start = static_cast<uint32_t>(rng() % universe);
+            for (uint32_t i = 0; i < 1000 && ids.size() < count; ++i) {
+                ids.push_back(start + i);
+            }
+        }
+        else {
+            ids.push_back(static_cast<uint32_t>(rng() % universe));
+        }
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    SimpleVector<uint32_t> result(ids.size());
+    copy(ids.begin(), ids.end(), result.begin());
+    return result;
+}
+
+void MeasureIntersection(string_view name, size_t count, uint64_t universe, bool runs) {
+    mt19937_64 rng(23);
+    const SimpleVector<uint32_t> a = MakeSortedIds(rng, count, universe, runs);
+    const SimpleVector<uint32_t> b = MakeSortedIds(rng, count, universe, runs);
+    RoaringBitmap a_bitmap(a);
+    RoaringBitmap b_bitmap(b);
+    if (runs) {
+        a_bitmap.RunOptimize();
+        b_bitmap.RunOptimize();
+    }
+    constexpr int repeats = 5;
+
+    SimpleVector<uint32_t> out(min(a.GetSize(), b.GetSize()));
+    size_t vector_result = 0;
+    Timer vector_timer;
+    for (int i = 0; i < repeats; ++i) {
+        vector_result = set_intersection(a.begin(), a.end(), b.begin(), b.end(), out.begin()) - out.begin();
+    }
+    const double vector_seconds = vector_timer.GetSeconds() / repeats;
+
+    uint64_t bitmap_result = 0;
+    Timer bitmap_timer;
+    for (int i = 0; i < repeats; ++i) {
+        bitmap_result = And(a_bitmap, b_bitmap).GetCardinality();
+    }
+    const double bitmap_seconds = bitmap_timer.GetSeconds() / repeats;
+
+    if (bitmap_result != vector_result) {
+        cerr << "roaring: results differ" << endl;
+    }
+    cout << "  " << setw(8) << left << name << right << fixed << setprecision(2)
+         << " vector " << setw(8) << vector_seconds * 1e3 << " ms " << setw(7) << ToMiB(a.GetSize() * sizeof(uint32_t))
+         << " MiB, roaring " << setw(8) << bitmap_seconds * 1e3 << " ms " << setw(7)
+         << ToMiB(a_bitmap.GetSizeInBytes()) << " MiB, result " << vector_result << endl;
+}
+
+void BenchmarkRoaring(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 4000000);
+    cout << "roaring: " << count << " values per set" << endl;
+    MeasureIntersection("sparse", count, uint64_t{1} << 32, false);
+    MeasureIntersection("medium", count, count * 16, false);
+    MeasureIntersection("dense", count, count * 2, false);
+    MeasureIntersection("runs", count, uint64_t{1} << 32, true);
+}
+
+// ---------------------------------------------------------------------------
+// rle [values] [mean run length]
+//
+// Столбец статусов uint8_t с длинными сериями: память, подсчёт значения, сумма
+// и случайный доступ в SimpleVector<uint8_t> против RleVector<uint8_t>
+
+void BenchmarkRle(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 64 << 20);
+    const size_t mean_run = max<size_t>(ParseArg(args, 1, 1000), 1);
+    cout << "rle: " << count << " values, mean run " << mean_run << endl;
+
+    mt19937_64 rng(31);
+    SimpleVector<uint8_t> plain;
+    plain.Reserve(count);
+    RleVector<uint8_t> rle;
+    while (plain.GetSize() < count) {
+        const uint8_t status = static_cast<uint8_t>(rng() % 8);
+        const size_t length = min(1 + rng() % (2 * mean_run), count - plain.GetSize());
+        for (size_t i = 0; i < length; ++i) {
+            plain.PushBack(status);
+        }
+        rle.AppendRun(status, length);
+    }
+
+    constexpr size_t lookups = 1000000;
+    SimpleVector<size_t> indexes(lookups);
+    for (size_t& index : indexes) {
+        index = rng() % count;
+    }
+
+    auto measure = [&](string_view name, size_t bytes, auto count_status, auto sum, auto at) {
+        Timer count_timer;
+        const size_t counted = count_status(uint8_t{3});
+        const double count_seconds = count_timer.GetSeconds();
+        Timer sum_timer;
+        const int64_t total = sum();
+        const double sum_seconds = sum_timer.GetSeconds();
+        Timer at_timer;
+        size_t checksum = 0;
+        for (const size_t index : indexes) {
+            checksum += at(index);
+        }
+        const double at_seconds = at_timer.GetSeconds();
+        cout << "  " << setw(12) << left << name << right << fixed << setprecision(2)
+             << setw(9) << ToMiB(bytes) << " MiB, count " << setw(8) << count_seconds * 1e3
+             << " ms, sum " << setw(8) << sum_seconds * 1e3 << " ms, random access "
+             << setw(6) << at_seconds * 1e9 / lookups << " ns"
+             << " (" << counted << ", " << total << ", " << checksum << ')' << endl;
+    };
+    measure("SimpleVector", plain.GetCapacity(),
+        [&](uint8_t status) {
+            return static_cast<size_t>(std::count(plain.begin(), plain.end(), status));
+        },
+        [&] {
+            return accumulate(plain.begin(), plain.end(), int64_t{0});
+        },
+        [&](size_t index) {
+            return plain[index];
+        });
+    measure("RleVector", rle.GetSizeInBytes(),
+        [&](uint8_t status) {
+            return rle.Count(status);
+        },
+        [&] {
+            return rle.Sum();
+        },
+        [&](size_t index) {
+            return rle[index];
+        });
+}
+
+// ---------------------------------------------------------------------------
+// transform [values]
+//
+// Конвейер int32_t -> float -> float -> int16_t -> uint8_t: новый вектор
+// на каждом шаге против TransformInto, переиспользующего буфер
+
+template <typename Result, typename Source, typename Function>
+SimpleVector<Result> TransformCopy(SimpleVector<Source>&& source, Function function) {
+    const SimpleVector<Source> consumed(std::move(source));
+    SimpleVector<Result> result(consumed.GetSize());
+    transform(consumed.begin(), consumed.end(), result.begin(), function);
+    return result;
+}
+
+template <typename Stage>
+void MeasurePipeline(string_view name, const SimpleVector<int32_t>& input, Stage stage) {
+    SimpleVector<int32_t> source = input;
+    const size_t allocations_before = memory_stats::GetAllocations();
+    memory_stats::ResetPeak();
+    Timer timer;
+    auto scaled = stage.template operator()<float>(std::move(source), [](int32_t value) {
+        return value * (1.0f / 1024);
+    });
+    auto clamped = stage.template operator()<float>(std::move(scaled), [](float value) {
+        return value < -100.0f ? -100.0f : (value > 100.0f ? 100.0f : value);
+    });
+    auto quantized = stage.template operator()<int16_t>(std::move(clamped), [](float value) {
+        return static_cast<int16_t>(value * 256);
+    });
+    auto bytes = stage.template operator()<uint8_t>(std::move(quantized), [](int16_t value) {
+        return static_cast<uint8_t>(value >> 8);
+    });
+    const double seconds = timer.GetSeconds();
+    uint64_t checksum = 0;
+    for (const uint8_t value : bytes) {
+        checksum += value;
+    }
+    cout << "  " << setw(13) << left << name << right << fixed << setprecision(2)
+         << setw(8) << seconds * 1e3 << " ms, "
+         << memory_stats::GetAllocations() - allocations_before << " allocations, peak +"
+         << ToMiB(memory_stats::GetPeakGrowth()) << " MiB"
+         << " (checksum " << checksum << ')' << endl;
+}
+
+void BenchmarkTransform(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 16 << 20);
+    cout << "transform: " << count << " values, 4 stages" << endl;
+    SimpleVector<int32_t> input(count);
+    mt19937 rng(37);
+    for (int32_t& value : input) {
+        value = static_cast<int32_t>(rng());
+    }
+    MeasurePipeline("new buffers", input, []<typename Result>(auto&& source, auto function) {
+        return TransformCopy<Result>(std::move(source), function);
+    });
+    MeasurePipeline("TransformInto", input, []<typename Result>(auto&& source, auto function) {
+        return TransformInto<Result>(std::move(source), function);
+    });
+}
+
+// ---------------------------------------------------------------------------
+// key-sort [vectors]
+//
+// Сортировка SimpleVector<SimpleVector<int>>: std::sort с operator< против
+// SortByNormalizedKey. Векторы длиной 1-8, в половине из них общий префикс из одного элемента
+
+void BenchmarkKeySort(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 1000000);
+    cout << "key-sort: " << count << " vectors" << endl;
+    mt19937 rng(43);
+    SimpleVector<SimpleVector<int>> input;
+    input.Reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        SimpleVector<int> items(1 + rng() % 8);
+        for (int& item : items) {
+            item = static_cast<int>(rng());
+        }
+        if (i % 2) {
+            items[0] = 42;
+        }
+        input.PushBack(std::move(items));
+    }
+
+    SimpleVector<SimpleVector<int>> by_compare = input;
+    Timer compare_timer;
+    sort(by_compare.begin(), by_compare.end());
+    const double compare_seconds = compare_timer.GetSeconds();
+
+    SimpleVector<SimpleVector<int>> by_key = input;
+    Timer key_timer;
+    SortByNormalizedKey(by_key);
+    const double key_seconds = key_timer.GetSeconds();
+
+    if (by_compare != by_key) {
+        cerr << "key-sort: results differ" << endl;
+    }
+    cout << fixed << setprecision(1)
+         << "  std::sort           " << setw(8) << compare_seconds * 1e3 << " ms" << endl
+         << "  SortByNormalizedKey " << setw(8) << key_seconds * 1e3 << " ms" << endl;
+}
+
+// ---------------------------------------------------------------------------
+// merge [runs] [run length] [threads]
+//
+// Слияние отсортированных прогонов uint64_t: попарные слияния std::merge
+// по кругу против MergeK и MergeKParallel
+
+SimpleVector<uint64_t> MergePairwise(SimpleVector<SimpleVector<uint64_t>> runs) {
+    while (runs.GetSize() > 1) {
+        SimpleVector<SimpleVector<uint64_t>> merged;
+        for (size_t i = 0; i + 1 < runs.GetSize(); i += 2) {
+            SimpleVector<uint64_t> out(runs[i].GetSize() + runs[i + 1].GetSize());
+            merge(runs[i].begin(), runs[i].end(), runs[i + 1].begin(), runs[i + 1].end(), out.begin());
+            merged.PushBack(std::move(out));
+        }
+        if (runs.GetSize() % 2) {
+            merged.PushBack(std::move(runs[runs.GetSize() - 1]));
+        }
+        runs.swap(merged);
+    }
+    return runs.IsEmpty() ? SimpleVector<uint64_t>() : std::move(runs[0]);
+}
+
+void BenchmarkMerge(const vector<string>& args) {
+    const size_t run_count = ParseArg(args, 0, 32);
+    const size_t run_length = ParseArg(args, 1, 500000);
+    const size_t threads = ParseArg(args, 2, max(thread::hardware_concurrency(), 1u));
+    cout << "merge: " << run_count << " runs of " << run_length << " values, " << threads << " threads" << endl;
+
+    mt19937_64 rng(53);
+    SimpleVector<SimpleVector<uint64_t>> runs(run_count);
+    for (auto& run : runs) {
+        run.Resize(run_length);
+        for (uint64_t& value : run) {
+            value = rng();
+        }
+        sort(run.begin(), run.end());
+    }
+
+    Timer pairwise_timer;
+    const SimpleVector<uint64_t> pairwise = MergePairwise(runs);
+    const double pairwise_seconds = pairwise_timer.GetSeconds();
+
+    Timer tree_timer;
+    const SimpleVector<uint64_t> tree = MergeK(runs);
+    const double tree_seconds = tree_timer.GetSeconds();
+
+    Timer parallel_timer;
+    const SimpleVector<uint64_t> parallel = MergeKParallel(runs, threads);
+    const double parallel_seconds = parallel_timer.GetSeconds();
+
+    if (pairwise != tree || tree != parallel) {
+        cerr << "merge: results differ" << endl;
+    }
+    const double values = static_cast<double>(run_count * run_length);
+    cout << fixed << setprecision(1)
+         << "  pairwise       " << setw(8) << pairwise_seconds * 1e3 << " ms, "
+         << setprecision(2) << pairwise_seconds * 1e9 / values << " ns/value" << endl
+         << setprecision(1)
+         << "  MergeK         " << setw(8) << tree_seconds * 1e3 << " ms, "
+         << setprecision(2) << tree_seconds * 1e9 / values << " ns/value" << endl
+         << setprecision(1)
+         << "  MergeKParallel " << setw(8) << parallel_seconds * 1e3 << " ms, "
+         << setprecision(2) << parallel_seconds * 1e9 / values << " ns/value" << endl;
+}
+
+// ---------------------------------------------------------------------------
+// partition [tuples]
+//
+// Разбиение 16-байтовых кортежей по корзинам хэша: PushBack в вектор корзины
+// против RadixPartition в один и несколько проходов при разном числе корзин
+
+struct JoinTuple {
+    uint64_t key;
+    uint64_t payload;
+
+    bool operator==(const JoinTuple&) const = default;
+};
+
+uint64_t HashKey(const JoinTuple& tuple) {
+    return tuple.key * 0x9E3779B97F4A7C15ULL >> 20;
+}
+
+void BenchmarkPartition(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 16 << 20);
+    cout << "partition: " << count << " tuples" << endl;
+    mt19937_64 rng(61);
+    SimpleVector<JoinTuple> tuples(count);
+    for (size_t i = 0; i < count; ++i) {
+        tuples[i] = {rng(), i};
+    }
+
+    for (const size_t radix_bits : {8, 12, 16}) {
+        const size_t bucket_count = size_t{1} << radix_bits;
+        Timer naive_timer;
+        SimpleVector<SimpleVector<JoinTuple>> naive(bucket_count);
+        for (const JoinTuple& tuple : tuples) {
+            naive[HashKey(tuple) & (bucket_count - 1)].PushBack(tuple);
+        }
+        const double naive_seconds = naive_timer.GetSeconds();
+        cout << "  " << setw(6) << bucket_count << " buckets: PushBack " << fixed << setprecision(2)
+             << setw(6) << naive_seconds * 1e9 / count << " ns/tuple";
+
+        for (const size_t pass_bits : {radix_bits, (radix_bits + 1) / 2}) {
+            Timer timer;
+            const auto buckets = RadixPartition(tuples, radix_bits, HashKey, pass_bits);
+            const double seconds = timer.GetSeconds();
+            if (buckets[bucket_count - 1] != naive[bucket_count - 1]) {
+                cerr << "partition: results differ" << endl;
+            }
+            const size_t passes = (radix_bits + pass_bits - 1) / pass_bits;
+            cout << ", " << passes << (passes == 1 ? " pass " : " passes ") << setw(6)
+                 << seconds * 1e9 / count << " ns/tuple";
+        }
+        cout << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// group-by [rows]
+//
+// SUM/COUNT/MIN/MAX по группам при разном числе групп:
+// std::unordered_map со структурой агрегатов против GroupBy
+
+void BenchmarkGroupBy(const vector<string>& args) {
+    const size_t rows = ParseArg(args, 0, 16 << 20);
+    cout << "group-by: " << rows << " rows" << endl;
+    mt19937_64 rng(71);
+    SimpleVector<int64_t> keys(rows);
+    SimpleVector<int32_t> values(rows);
+    for (int32_t& value : values) {
+        value = static_cast<int32_t>(rng() % 1000000);
+    }
+
+    for (const uint64_t groups : {uint64_t{100}, uint64_t{100000}, uint64_t{4000000}}) {
+        for (int64_t& key : keys) {
+            key = static_cast<int64_t>(rng() % groups * 7919);
+        }
+
+        struct Aggregates {
+            uint64_t count = 0;
+            int64_t sum = 0;
+            int32_t min = INT32_MAX;
+            int32_t max = INT32_MIN;
+        };
+        Timer map_timer;
+        unordered_map<int64_t, Aggregates> map;
+        for (size_t i = 0; i < rows; ++i) {
+            Aggregates& a = map[keys[i]];
+            ++a.count;
+            a.sum += values[i];
+            a.min = min(a.min, values[i]);
+            a.max = max(a.max, values[i]);
+        }
+        const double map_seconds = map_timer.GetSeconds();
+
+        Timer group_timer;
+        const GroupByResult<int32_t> result = GroupBy(keys, values);
+        const double group_seconds = group_timer.GetSeconds();
+
+        if (result.GetGroupCount() != map.size() || result.sums[0] != map.at(result.keys[0]).sum) {
+            cerr << "group-by: results differ" << endl;
+        }
+        cout << "  " << setw(8) << result.GetGroupCount() << " groups: unordered_map " << fixed << setprecision(2)
+             << setw(6) << map_seconds * 1e9 / rows << " ns/row, GroupBy " << setw(6)
+             << group_seconds * 1e9 / rows << " ns/row" << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// sorted-lookup [size] [lookups]
+//
+// Поиск в векторе, который заполняется по возрастанию: std::find по SimpleVector
+// против SortTrackingVector, переходящего на двоичный поиск, и цена учёта порядка в PushBack
+
+void BenchmarkSortedLookup(const vector<string>& args) {
+    const size_t size = ParseArg(args, 0, 100000);
+    const size_t lookups = ParseArg(args, 1, 100000);
+    cout << "sorted-lookup: " << size << " values, " << lookups << " lookups" << endl;
+    mt19937_64 rng(73);
+
+    Timer plain_fill_timer;
+    SimpleVector<uint64_t> plain;
+    for (size_t i = 0; i < size; ++i) {
+        plain.PushBack(i * 3);
+    }
+    const double plain_fill_seconds = plain_fill_timer.GetSeconds();
+
+    Timer tracked_fill_timer;
+    SortTrackingVector<uint64_t> tracked;
+    for (size_t i = 0; i < size; ++i) {
+        tracked.PushBack(i * 3);
+    }
+    const double tracked_fill_seconds = tracked_fill_timer.GetSeconds();
+
+    SimpleVector<uint64_t> queries(lookups);
+    for (uint64_t& query : queries) {
+        query = rng() % (3 * size);
+    }
+    // линейный поиск проверяется на части запросов, иначе он идёт минутами
+    const size_t linear_lookups = max<size_t>(lookups / 100, 1);
+    size_t plain_found = 0;
+    Timer plain_timer;
+    for (size_t i = 0; i < linear_lookups; ++i) {
+        plain_found += find(plain.begin(), plain.end(), queries[i]) != plain.end();
+    }
+    const double plain_seconds = plain_timer.GetSeconds();
+
+    size_t tracked_found = 0;
+    Timer tracked_timer;
+    for (const uint64_t query : queries) {
+        tracked_found += tracked.Contains(query);
+    }
+    const double tracked_seconds = tracked_timer.GetSeconds();
+
+    cout << fixed << setprecision(2)
+         << "  PushBack: SimpleVector " << plain_fill_seconds * 1e9 / size << " ns, SortTrackingVector "
+         << tracked_fill_seconds * 1e9 / size << " ns" << endl
+         << "  lookup: std::find " << setprecision(1) << plain_seconds * 1e9 / linear_lookups
+         << " ns, SortTrackingVector::Contains " << tracked_seconds * 1e9 / lookups << " ns"
+         << " (found " << plain_found << " of " << linear_lookups << ", " << tracked_found << " of " << lookups << ')'
+         << endl;
+}
+
+// ---------------------------------------------------------------------------
+// reclaim [vectors] [size]
+//
+// Векторы с запасом вместимости вчетверо: сколько памяти возвращает проход
+// memory_reclaimer::ReclaimIdle, сколько он длится и во что обходится Lock при обращении
+
+void BenchmarkReclaim(const vector<string>& args) {
+    const size_t count = ParseArg(args, 0, 10000);
+    const size_t size = ParseArg(args, 1, 256);
+    cout << "reclaim: " << count << " vectors of " << size << " int64_t" << endl;
+
+    vector<unique_ptr<memory_reclaimer::ReclaimableVector<int64_t>>> vectors;
+    vectors.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        vectors.push_back(make_unique<memory_reclaimer::ReclaimableVector<int64_t>>());
+        auto items = vectors.back()->Lock();
+        items->Reserve(4 * size);
+        for (size_t j = 0; j < size; ++j) {
+            items->PushBack(static_cast<int64_t>(j));
+        }
+    }
+
+    const size_t rounds = 100;
+    int64_t sum = 0;
+    Timer lock_timer;
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto& v : vectors) {
+            sum += (*v->Lock())[round % size];
+        }
+    }
+    const double lock_seconds = lock_timer.GetSeconds();
+
+    const size_t live_before = memory_stats::GetLiveBytes();
+    Timer pass_timer;
+    const memory_reclaimer::ReclaimStats pass = memory_reclaimer::ReclaimIdle();
+    const double pass_seconds = pass_timer.GetSeconds();
+    const size_t live_after = memory_stats::GetLiveBytes();
+
+    Timer idle_timer;
+    memory_reclaimer::ReclaimIdle();
+    const double idle_seconds = idle_timer.GetSeconds();
+
+    cout << fixed << setprecision(2)
+         << "  Lock + read: " << lock_seconds * 1e9 / (rounds * count) << " ns" << endl
+         << "  pass: " << pass_seconds * 1e3 << " ms, " << pass.vectors_shrunk << " vectors shrunk, "
+         << ToMiB(pass.bytes_reclaimed) << " MiB reclaimed, live " << ToMiB(live_before) << " -> "
+         << ToMiB(live_after) << " MiB" << endl
+         << "  pass with nothing to reclaim: " << idle_seconds * 1e3 << " ms (checksum " << sum << ')' << endl;
+}
+
+// ---------------------------------------------------------------------------
+// sum [size] [threads]
+//
+// Сумма double: обычное сложение в одном потоке и по частям в нескольких потоках
+// (результат зависит от числа потоков) против DeterministicSum, побитово одинаковой при любом их числе
+
+double NaiveParallelSum(const SimpleVector<double>& values, size_t threads) {
+    vector<double> sums(threads);
+    vector<thread> workers;
+    for (size_t part = 0; part < threads; ++part) {
+        workers.emplace_back([&, part] {
+            double sum = 0.0;
+            const size_t end = values.GetSize() * (part + 1) / threads;
+            for (size_t i = values.GetSize() * part / threads; i < end; ++i) {
+                sum += values[i];
+            }
+            sums[part] = sum;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return accumulate(sums.begin(), sums.end(), 0.0);
+}
+
+void BenchmarkSum(const vector<string>& args) {
+    const size_t size = ParseArg(args, 0, 1 << 24);
+    const size_t max_threads = max<size_t>(ParseArg(args, 1, 4), 1);
+    cout << "sum: " << size << " doubles, up to " << max_threads << " threads" << endl;
+    mt19937_64 rng(121);
+    SimpleVector<double> values(size);
+    for (double& value : values) {
+        const int64_t mantissa = static_cast<int64_t>(rng() >> 12) - (int64_t{1} << 51);
+        value = ldexp(static_cast<double>(mantissa), static_cast<int>(rng() % 40) - 20);
+    }
+    const double gb = static_cast<double>(size * sizeof(double)) / 1e9;
+
+    const size_t rounds = 5;
+    double sequential = 0.0;
+    Timer sequential_timer;
+    for (size_t round = 0; round < rounds; ++round) {
+        sequential = 0.0;
+        for (const double value : values) {
+            sequential += value;
+        }
+    }
+    const double sequential_seconds = sequential_timer.GetSeconds() / rounds;
+    cout << "  naive:      " << defaultfloat << setprecision(17) << sequential << " (" << fixed
+         << setprecision(2) << gb / sequential_seconds << " GB/s)" << endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double naive = 0.0;
+        Timer naive_timer;
+        for (size_t round = 0; round < rounds; ++round) {
+            naive = NaiveParallelSum(values, threads);
+        }
+        const double naive_seconds = naive_timer.GetSeconds() / rounds;
+
+        double deterministic = 0.0;
+        Timer deterministic_timer;
+        for (size_t round = 0; round < rounds; ++round) {
+            deterministic = DeterministicSum(values, threads);
+        }
+        const double deterministic_seconds = deterministic_timer.GetSeconds() / rounds;
+
+        cout << "  " << threads << " threads: naive " << defaultfloat << setprecision(17) << naive << " ("
+             << fixed << setprecision(2) << gb / naive_seconds << " GB/s), deterministic " << defaultfloat
+             << setprecision(17) << deterministic << " (" << fixed << setprecision(2)
+             << gb / deterministic_seconds << " GB/s)" << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// quantized [rows] [dim]
+//
+// Таблица эмбеддингов rows x dim: память и скалярные произведения запроса со всеми строками
+// для SimpleVector<float> (простой цикл) и QuantizedVector в форматах Float16, BFloat16 и Int8
+
+template <Quantization Format>
+void MeasureQuantized(string_view name, const SimpleVector<float>& table, const SimpleVector<float>& query,
+                      size_t rows, const SimpleVector<float>& exact) {
+    const QuantizedVector<Format> quantized(table);
+    const size_t dim = query.GetSize();
+    SimpleVector<float> scores(rows);
+    Timer timer;
+    for (size_t row = 0; row < rows; ++row) {
+        scores[row] = quantized.Dot(row * dim, query.begin(), dim);
+    }
+    const double seconds = timer.GetSeconds();
+    double max_error = 0.0;
+    for (size_t row = 0; row < rows; ++row) {
+        max_error = max(max_error, static_cast<double>(fabs(scores[row] - exact[row])));
+    }
+    SimpleVector<float> decoded(dim);
+    Timer decode_timer;
+    for (size_t row = 0; row < rows; ++row) {
+        quantized.Decode(row * dim, dim, decoded.begin());
+    }
+    const double decode_seconds = decode_timer.GetSeconds();
+    cout << "  " << left << setw(10) << name << right << setw(8) << ToMiB(quantized.GetSizeInBytes()) << " MiB, dot "
+         << setw(6) << seconds * 1e9 / rows << " ns/row, decode " << setw(6) << decode_seconds * 1e9 / rows
+         << " ns/row, max score error " << scientific << setprecision(1) << max_error << fixed << setprecision(2)
+         << endl;
+}
+
+void BenchmarkQuantized(const vector<string>& args) {
+    const size_t rows = ParseArg(args, 0, 100000);
+    const size_t dim = ParseArg(args, 1, 128);
+    cout << "quantized: " << rows << " rows x " << dim << " floats" << endl;
+    mt19937 rng(122);
+    normal_distribution<float> distribution(0.0f, 1.0f);
+    SimpleVector<float> table(rows * dim);
+    for (float& value : table) {
+        value = distribution(rng);
+    }
+    SimpleVector<float> query(dim);
+    for (float& value : query) {
+        value = distribution(rng);
+    }
+
+    SimpleVector<float> exact(rows);
+    Timer timer;
+    for (size_t row = 0; row < rows; ++row) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < dim; ++i) {
+            sum += table[row * dim + i] * query[i];
+        }
+        exact[row] = sum;
+    }
+    const double seconds = timer.GetSeconds();
+    cout << fixed << setprecision(2) << "  " << left << setw(10) << "float" << right << setw(8)
+         << ToMiB(table.GetSize() * sizeof(float)) << " MiB, dot " << setw(6) << seconds * 1e9 / rows << " ns/row"
+         << endl;
+
+    MeasureQuantized<Quantization::Float16>("Float16", table, query, rows, exact);
+    MeasureQuantized<Quantization::BFloat16>("BFloat16", table, query, rows, exact);
+    MeasureQuantized<Quantization::Int8>("Int8", table, query, rows, exact);
+}
+
+// ---------------------------------------------------------------------------
+// top-k [rows] [dim] [k]
+//
+// Перебор ближайших строк: расстояния до всех строк простым циклом и полная сортировка
+// против групповых SIMD-ядер с отбором SearchTopK в куче из k строк
+
+void BenchmarkTopK(const vector<string>& args) {
+    const size_t row_count = ParseArg(args, 0, 200000);
+    const size_t dim = max<size_t>(ParseArg(args, 1, 128), 1);
+    const size_t k = ParseArg(args, 2, 10);
+    cout << "top-k: " << row_count << " rows x " << dim << " floats, k = " << k << endl;
+    mt19937 rng(123);
+    normal_distribution<float> distribution(0.0f, 1.0f);
+    SimpleVector<float> rows(row_count * dim);
+    for (float& value : rows) {
+        value = distribution(rng);
+    }
+    SimpleVector<float> query(dim);
+    for (float& value : query) {
+        value = distribution(rng);
+    }
+
+    memory_stats::ResetPeak();
+    Timer sort_timer;
+    SimpleVector<SearchHit> all(row_count);
+    for (size_t row = 0; row < row_count; ++row) {
+        float distance = 0.0f;
+        for (size_t i = 0; i < dim; ++i) {
+            const float difference = rows[row * dim + i] - query[i];
+            distance += difference * difference;
+        }
+        all[row] = {row, distance};
+    }
+    sort(all.begin(), all.end(), [](const SearchHit& lhs, const SearchHit& rhs) {
+        return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.row < rhs.row);
+    });
+    const double sort_seconds = sort_timer.GetSeconds();
+    const size_t sort_peak = memory_stats::GetPeakGrowth();
+
+    cout << fixed << setprecision(2) << "  L2, all scores + sort: " << sort_seconds * 1e3 << " ms, extra "
+         << ToMiB(sort_peak) << " MiB" << endl;
+    for (const auto& [name, metric] : {pair<string_view, Metric>{"L2", Metric::L2}, {"Dot", Metric::Dot},
+                                       {"Cosine", Metric::Cosine}}) {
+        memory_stats::ResetPeak();
+        Timer timer;
+        const SimpleVector<SearchHit> hits = SearchTopK(rows, dim, query, k, metric);
+        const double seconds = timer.GetSeconds();
+        const size_t peak = memory_stats::GetPeakGrowth();
+        cout << "  " << name << ", SearchTopK: " << seconds * 1e3 << " ms, extra " << peak << " bytes";
+        if (metric == Metric::L2) {
+            const bool same = k <= row_count && equal(hits.begin(), hits.end(), all.begin(),
+                                                      [](const SearchHit& lhs, const SearchHit& rhs) {
+                                                          return lhs.row == rhs.row;
+                                                      });
+            cout << (same ? ", same rows as sort" : ", rows differ from sort (rounding)");
+        }
+        cout << endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// append-log [records] [path]
+//
+// Дописывание записей аудита в AppendLog при разных размерах пакета:
+// каждый пакет — одна запись в файл и один fdatasync
+
+struct AuditRecord {
+    uint64_t id = 0;
+    uint64_t timestamp = 0;
+    int32_t user = 0;
+    int32_t action = 0;
+};
+
+void BenchmarkAppendLog(const vector<string>& args) {
+    const size_t records = ParseArg(args, 0, 20000);
+    const string path = args.size() > 1 ? args[1]
+                                        : (filesystem::temp_directory_path() / "simple_vector_append_log.bin").string();
+    cout << "append-log: " << records << " records of " << sizeof(AuditRecord) << " bytes to " << path << endl;
+    for (const size_t batch_size : {1, 8, 64, 512}) {
+        filesystem::remove(path);
+        // при пакете из одной записи каждый fdatasync ждёт диск, поэтому записей меньше
+        const size_t count = batch_size == 1 ? max<size_t>(records / 20, 1) : records;
+        Timer timer;
+        {
+            AppendLog<AuditRecord> log(path, batch_size);
+            for (size_t i = 0; i < count; ++i) {
+                log.Append({i, i * 1000, static_cast<int32_t>(i % 97), static_cast<int32_t>(i % 5)});
+            }
+            log.Commit();
+        }
+        const double seconds = timer.GetSeconds();
+        Timer recover_timer;
+        const AppendLog<AuditRecord> log(path, batch_size);
+        const double recover_seconds = recover_timer.GetSeconds();
+        cout << fixed << setprecision(0) << "  batch " << setw(4) << batch_size << ": " << setw(9)
+             << count / seconds << " appends/s, " << setprecision(2) << seconds * 1e6 / count
+             << " us/append, reopen " << recover_seconds * 1e3 << " ms (" << log.GetSize() << " records)" << endl;
+    }
+    filesystem::remove(path);
+}
+
+// ---------------------------------------------------------------------------
+// dedup [size] [distinct]
+//
+// Удаление повторов: sort + unique в коде пользователя против Deduplicate
+// на случайных, уже отсортированных и коротких векторах
+
+double MeasureDedup(const SimpleVector<int64_t>& source, size_t rounds, auto dedup) {
+    SimpleVector<int64_t> items;
+    double seconds = 0.0;
+    for (size_t round = 0; round < rounds; ++round) {
+        items = source;
+        Timer timer;
+        dedup(items);
+        seconds += timer.GetSeconds();
+    }
+    return seconds * 1e9 / rounds / source.GetSize();
+}
+
+void BenchmarkDedup(const vector<string>& args) {
+    const size_t size = ParseArg(args, 0, 1000000);
+    const size_t distinct = max<size_t>(ParseArg(args, 1, 100000), 1);
+    cout << "dedup: " << size << " values, " << distinct << " distinct" << endl;
+    mt19937_64 rng(125);
+    SimpleVector<int64_t> random(size);
+    for (int64_t& value : random) {
+        value = static_cast<int64_t>(rng() % distinct);
+    }
+    SimpleVector<int64_t> sorted = random;
+    sort(sorted.begin(), sorted.end());
+    SimpleVector<int64_t> small(16);
+    for (int64_t& value : small) {
+        value = static_cast<int64_t>(rng() % 8);
+    }
+
+    auto sort_unique = [](SimpleVector<int64_t>& items) {
+        sort(items.begin(), items.end());
+        items.Resize(static_cast<size_t>(unique(items.begin(), items.end()) - items.begin()));
+    };
+    auto keep_order = [](SimpleVector<int64_t>& items) {
+        Deduplicate(items);
+    };
+
+    const size_t rounds = 5;
+    const size_t small_rounds = 100000;
+    cout << fixed << setprecision(2)
+         << "  random: sort + unique " << MeasureDedup(random, rounds, sort_unique)
+         << " ns/value, Deduplicate " << MeasureDedup(random, rounds, keep_order) << " ns" << endl
+         << "  sorted: sort + unique " << MeasureDedup(sorted, rounds, sort_unique)
+         << " ns/value, Deduplicate " << MeasureDedup(sorted, rounds, keep_order) << " ns" << endl
+         << "  16 values: sort + unique " << MeasureDedup(small, small_rounds, sort_unique)
+         << " ns/value, Deduplicate " << MeasureDedup(small, small_rounds, keep_order) << " ns" << endl;
+}
+
+// ---------------------------------------------------------------------------
+
+struct Benchmark {
+    string_view name;
+    void (*run)(const vector<string>& args);
+    // Выполняется при запуске без аргументов
+    bool run_by_default;
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"soak", BenchmarkSoak, false},
+    {"replay", BenchmarkReplay, false},
+    {"latency", BenchmarkLatency, true},
+    {"loader", BenchmarkLoader, true},
+    {"csv", BenchmarkCsv, true},
+    {"string-builder", BenchmarkStringBuilder, true},
+    {"byteswap", BenchmarkByteSwap, true},
+    {"poly", BenchmarkPoly, true},
+    {"prefix-sum", BenchmarkPrefixSum, true},
+    {"roaring", BenchmarkRoaring, true},
+    {"rle", BenchmarkRle, true},
+    {"transform", BenchmarkTransform, true},
+    {"key-sort", BenchmarkKeySort, true},
+    {"merge", BenchmarkMerge, true},
+    {"partition", BenchmarkPartition, true},
+    {"group-by", BenchmarkGroupBy, true},
+    {"sorted-lookup", BenchmarkSortedLookup, true},
+    {"reclaim", BenchmarkReclaim, true},
+    {"sum", BenchmarkSum, true},
+    {"quantized", BenchmarkQuantized, true},
+    {"top-k", BenchmarkTopK, true},
+    {"append-log", BenchmarkAppendLog, true},
+    {"dedup", BenchmarkDedup, true},
+};
+
+// Использование: benchmark [name [args...]]
+// Без аргументов запускает все быстрые бенчмарки
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        for (const auto& benchmark : BENCHMARKS) {
+            if (benchmark.run_by_default) {
+                benchmark.run({});
+            }
+        }
+        return 0;
+    }
+    const string_view name = argv[1];
+    for (const auto& benchmark : BENCHMARKS) {
+        if (benchmark.name == name) {
+            benchmark.run(vector<string>(argv + 2, argv + argc));
+            return 0;
+        }
+    }
+    cerr << "unknown benchmark: " << name << endl;
+    cerr << "available:";
+    for (const auto& benchmark : BENCHMARKS) {
+        cerr << ' ' << benchmark.name;
+    }
+    cerr << endl;
+    return 1;
+}
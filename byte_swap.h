@@ -0,0 +1,147 @@
+﻿#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSSE3__) || defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Перестановка байтов элементов размером 2, 4 и 8 байт для загрузки и выгрузки
+// данных в порядке big-endian. Ядро переставляет байты инструкцией pshufb
+// (SSSE3, AVX2 или AVX-512BW, в зависимости от флагов компиляции) и обрабатывает
+// хвост скалярно. Источник и приёмник могут совпадать
+namespace byte_swap_detail {
+
+// Маска pshufb, переворачивающая каждый элемент размером Size.
+// pshufb переставляет байты внутри 16-байтовых полос, поэтому маска повторяется
+template <size_t Size>
+struct ShuffleMask {
+    constexpr ShuffleMask()
+        : bytes()
+    {
+        for (size_t i = 0; i < 64; ++i) {
+            bytes[i] = static_cast<char>((i % 16) / Size * Size + Size - 1 - i % Size);
+        }
+    }
+
+    alignas(64) char bytes[64];
+};
+
+template <size_t Size>
+inline constexpr ShuffleMask<Size> SHUFFLE_MASK;
+
+template <typename Type>
+inline Type ByteSwapValue(Type value) noexcept {
+    if constexpr (sizeof(Type) == 2) {
+        return static_cast<Type>(__builtin_bswap16(static_cast<uint16_t>(value)));
+    }
+    else if constexpr (sizeof(Type) == 4) {
+        return static_cast<Type>(__builtin_bswap32(static_cast<uint32_t>(value)));
+    }
+    else {
+        return static_cast<Type>(__builtin_bswap64(static_cast<uint64_t>(value)));
+    }
+}
+
+// Переставляет байты count элементов размером Size из src в dst
+template <size_t Size>
+inline void ByteSwapCopy(const char* src, char* dst, size_t count) noexcept {
+    size_t offset = 0;
+    const size_t bytes = count * Size;
+#if defined(__AVX512BW__)
+    const __m512i mask512 = _mm512_load_si512(SHUFFLE_MASK<Size>.bytes);
+    for (; offset + 64 <= bytes; offset += 64) {
+        const __m512i value = _mm512_loadu_si512(src + offset);
+        _mm512_storeu_si512(dst + offset, _mm512_shuffle_epi8(value, mask512));
+    }
+#endif
+#if defined(__AVX2__)
+    const __m256i mask256 = _mm256_load_si256(reinterpret_cast<const __m256i*>(SHUFFLE_MASK<Size>.bytes));
+    for (; offset + 32 <= bytes; offset += 32) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + offset), _mm256_shuffle_epi8(value, mask256));
+    }
+#endif
+#if defined(__SSSE3__)
+    const __m128i mask128 = _mm_load_si128(reinterpret_cast<const __m128i*>(SHUFFLE_MASK<Size>.bytes));
+    for (; offset + 16 <= bytes; offset += 16) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset), _mm_shuffle_epi8(value, mask128));
+    }
+#endif
+    using Word = std::conditional_t<Size == 2, uint16_t, std::conditional_t<Size == 4, uint32_t, uint64_t>>;
+    for (; offset < bytes; offset += Size) {
+        Word value;
+        std::memcpy(&value, src + offset, Size);
+        value = ByteSwapValue(value);
+        std::memcpy(dst + offset, &value, Size);
+    }
+}
+
+template <typename Type>
+constexpr bool IS_SWAPPABLE = std::is_integral_v<Type> && (sizeof(Type) == 2 || sizeof(Type) == 4 || sizeof(Type) == 8);
+
+}  // namespace byte_swap_detail
+
+// Переставляет байты каждого из count элементов на месте
+template <typename Type>
+void ByteSwapInPlace(Type* data, size_t count) noexcept {
+    static_assert(byte_swap_detail::IS_SWAPPABLE<Type>, "ByteSwap supports 2, 4 and 8 byte integers");
+    auto* bytes = reinterpret_cast<char*>(data);
+    byte_swap_detail::ByteSwapCopy<sizeof(Type)>(bytes, bytes, count);
+}
+
+template <typename Type>
+void ByteSwapInPlace(SimpleVector<Type>& items) noexcept {
+    ByteSwapInPlace(items.begin(), items.GetSize());
+}
+
+// Дописывает в конец items целые элементы, записанные в data в порядке big-endian.
+// Возвращает число прочитанных байт: неполный последний элемент не читается,
+// чтобы при загрузке блоками его можно было перенести в следующий блок
+template <typename Type>
+size_t AppendBigEndian(const char* data, size_t size, SimpleVector<Type>& items) {
+    static_assert(byte_swap_detail::IS_SWAPPABLE<Type>, "ByteSwap supports 2, 4 and 8 byte integers");
+    const size_t count = size / sizeof(Type);
+    const size_t old_size = items.GetSize();
+    // новые элементы сразу перезаписываются, заполнять их нулями незачем
+    items.ResizeForOverwrite(old_size + count);
+    if (count == 0) {
+        return 0;
+    }
+    char* const dst = reinterpret_cast<char*>(items.begin() + old_size);
+    if constexpr (std::endian::native == std::endian::big) {
+        std::memcpy(dst, data, count * sizeof(Type));
+    }
+    else {
+        byte_swap_detail::ByteSwapCopy<sizeof(Type)>(data, dst, count);
+    }
+    return count * sizeof(Type);
+}
+
+template <typename Type>
+size_t AppendBigEndian(const SimpleVector<char>& bytes, SimpleVector<Type>& items) {
+    return AppendBigEndian(bytes.begin(), bytes.GetSize(), items);
+}
+
+// Записывает элементы items в out в порядке big-endian. В out должно быть место
+// для items.GetSize() * sizeof(Type) байт
+template <typename Type>
+void StoreBigEndian(const SimpleVector<Type>& items, char* out) noexcept {
+    static_assert(byte_swap_detail::IS_SWAPPABLE<Type>, "ByteSwap supports 2, 4 and 8 byte integers");
+    if (items.IsEmpty()) {
+        return;
+    }
+    const auto* src = reinterpret_cast<const char*>(items.begin());
+    if constexpr (std::endian::native == std::endian::big) {
+        std::memcpy(out, src, items.GetSize() * sizeof(Type));
+    }
+    else {
+        byte_swap_detail::ByteSwapCopy<sizeof(Type)>(src, out, items.GetSize());
+    }
+}
@@ -0,0 +1,266 @@
+﻿#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Разбор текста с разделителями в столбцы SimpleVector<int64_t> и SimpleVector<double>.
+// Разделители и переводы строк ищутся блоками по 64 байта (AVX2 или SSE2, если доступны),
+// числа разбираются std::from_chars, а значения пишутся сразу на свои места
+// в столбцах, заранее увеличенных на число строк блока
+enum class ColumnType {
+    Int64,
+    Double,
+};
+
+namespace csv_detail {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+// Маска позиций разделителя и '\n' в 64 байтах начиная с data
+inline uint64_t ScanFullBlock(const char* data, char delimiter) noexcept {
+#if defined(__AVX2__)
+    const __m256i delimiters = _mm256_set1_epi8(delimiter);
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+    const uint32_t low_mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(low, delimiters), _mm256_cmpeq_epi8(low, newlines))));
+    const uint32_t high_mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(high, delimiters), _mm256_cmpeq_epi8(high, newlines))));
+    return static_cast<uint64_t>(high_mask) << 32 | low_mask;
+#elif defined(__SSE2__)
+    const __m128i delimiters = _mm_set1_epi8(delimiter);
+    const __m128i newlines = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i));
+        const uint32_t chunk_mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, delimiters), _mm_cmpeq_epi8(chunk, newlines))));
+        mask |= static_cast<uint64_t>(chunk_mask) << (16 * i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        mask |= static_cast<uint64_t>(data[i] == delimiter || data[i] == '\n') << i;
+    }
+    return mask;
+#endif
+}
+
+// То же для блока длиной size <= 64: хвост копируется в буфер, дополненный нулями
+inline uint64_t ScanBlock(const char* data, size_t size, char delimiter) noexcept {
+    if (size >= BLOCK_SIZE) {
+        return ScanFullBlock(data, delimiter);
+    }
+    char padded[BLOCK_SIZE] = {};
+    std::memcpy(padded, data, size);
+    return ScanFullBlock(padded, delimiter) & ((uint64_t{1} << size) - 1);
+}
+
+// Число символов '\n' в тексте
+inline size_t CountLines(std::string_view text) noexcept {
+    size_t lines = 0;
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        // разделитель '\n' даёт маску только переводов строк
+        lines += __builtin_popcountll(ScanBlock(text.data() + offset, text.size() - offset, '\n'));
+    }
+    return lines;
+}
+
+}  // namespace csv_detail
+
+class CsvColumns {
+public:
+    // Создаёт пустые столбцы по схеме
+    CsvColumns(std::initializer_list<ColumnType> schema)
+        : columns_(schema.size())
+    {
+        size_t index = 0;
+        for (const ColumnType type : schema) {
+            columns_[index++].type = type;
+        }
+    }
+
+    size_t GetColumnCount() const noexcept {
+        return columns_.GetSize();
+    }
+
+    size_t GetRowCount() const noexcept {
+        return rows_;
+    }
+
+    ColumnType GetColumnType(size_t column) const {
+        return columns_.At(column).type;
+    }
+
+    // Возвращает столбец целых чисел. Выбрасывает std::invalid_argument, если столбец другого типа
+    const SimpleVector<int64_t>& GetInt64Column(size_t column) const {
+        const Column& c = columns_.At(column);
+        if (c.type != ColumnType::Int64) {
+            throw std::invalid_argument("column is not Int64");
+        }
+        return c.ints;
+    }
+
+    // Возвращает столбец чисел с плавающей точкой. Выбрасывает std::invalid_argument, если столбец другого типа
+    const SimpleVector<double>& GetDoubleColumn(size_t column) const {
+        const Column& c = columns_.At(column);
+        if (c.type != ColumnType::Double) {
+            throw std::invalid_argument("column is not Double");
+        }
+        return c.doubles;
+    }
+
+    // Добавляет строки из text. Последняя строка может не заканчиваться '\n',
+    // пустые строки и '\r' в конце строки пропускаются.
+    // Выбрасывает std::invalid_argument при неверном числе полей или нечисловом значении;
+    // в этом случае столбцы остаются такими, какими были до вызова
+    void Append(std::string_view text, char delimiter = ',') {
+        ParseLines(text, delimiter, true);
+    }
+
+    // Добавляет только завершённые '\n' строки из text и возвращает число разобранных байт.
+    // Удобно при чтении блоками: неразобранный остаток переносится в начало следующего блока
+    size_t AppendCompleteLines(std::string_view text, char delimiter = ',') {
+        const size_t end = text.rfind('\n');
+        if (end == std::string_view::npos) {
+            return 0;
+        }
+        ParseLines(text.substr(0, end + 1), delimiter, false);
+        return end + 1;
+    }
+
+private:
+    struct Column {
+        ColumnType type = ColumnType::Int64;
+        SimpleVector<int64_t> ints;
+        SimpleVector<double> doubles;
+    };
+
+    void ParseLines(std::string_view text, char delimiter, bool allow_unterminated) {
+        size_t max_rows = csv_detail::CountLines(text);
+        if (allow_unterminated && !text.empty() && text.back() != '\n') {
+            ++max_rows;
+        }
+        const size_t old_rows = rows_;
+        try {
+            // рост столбцов тоже откатывается: bad_alloc может прервать его на полпути
+            GrowColumns(old_rows + max_rows);
+            rows_ = ParseFields(text, delimiter, old_rows);
+        }
+        catch (...) {
+            ResizeColumns(old_rows);
+            throw;
+        }
+        ResizeColumns(rows_);
+    }
+
+    // Новые строки не заполняются: from_chars перезапишет каждую разобранную,
+    // а лишние обрезаются ResizeColumns
+    void GrowColumns(size_t rows) {
+        for (Column& column : columns_) {
+            if (column.type == ColumnType::Int64) {
+                column.ints.ResizeForOverwrite(rows);
+            }
+            else {
+                column.doubles.ResizeForOverwrite(rows);
+            }
+        }
+    }
+
+    void ResizeColumns(size_t rows) {
+        for (Column& column : columns_) {
+            if (column.type == ColumnType::Int64) {
+                column.ints.Resize(rows);
+            }
+            else {
+                column.doubles.Resize(rows);
+            }
+        }
+    }
+
+    // Разбирает поля text в строки начиная с row и возвращает число строк после разбора
+    size_t ParseFields(std::string_view text, char delimiter, size_t row) {
+        const char* const data = text.data();
+        size_t column = 0;
+        size_t field_start = 0;
+        for (size_t offset = 0; offset < text.size(); offset += csv_detail::BLOCK_SIZE) {
+            uint64_t mask = csv_detail::ScanBlock(data + offset, text.size() - offset, delimiter);
+            while (mask) {
+                const size_t position = offset + __builtin_ctzll(mask);
+                mask &= mask - 1;
+                if (data[position] == '\n') {
+                    size_t field_end = position;
+                    if (field_end > field_start && data[field_end - 1] == '\r') {
+                        --field_end;
+                    }
+                    if (column != 0 || field_end != field_start) {
+                        StoreField(row, column, text.substr(field_start, field_end - field_start));
+                        CheckRowComplete(row, column);
+                        ++row;
+                    }
+                    column = 0;
+                }
+                else {
+                    StoreField(row, column, text.substr(field_start, position - field_start));
+                    ++column;
+                }
+                field_start = position + 1;
+            }
+        }
+        // незавершённая последняя строка, в том числе оборванная после разделителя
+        if (field_start < text.size() || column != 0) {
+            size_t field_end = text.size();
+            if (field_end > field_start && data[field_end - 1] == '\r') {
+                --field_end;
+            }
+            if (column != 0 || field_end != field_start) {
+                StoreField(row, column, text.substr(field_start, field_end - field_start));
+                CheckRowComplete(row, column);
+                ++row;
+            }
+        }
+        return row;
+    }
+
+    void StoreField(size_t row, size_t column, std::string_view field) {
+        if (column >= columns_.GetSize()) {
+            throw std::invalid_argument("csv: too many fields in row " + std::to_string(row));
+        }
+        Column& c = columns_[column];
+        const char* const end = field.data() + field.size();
+        std::from_chars_result result;
+        if (c.type == ColumnType::Int64) {
+            result = std::from_chars(field.data(), end, c.ints[row]);
+        }
+        else {
+            result = std::from_chars(field.data(), end, c.doubles[row]);
+        }
+        if (result.ec != std::errc() || result.ptr != end || field.empty()) {
+            throw std::invalid_argument("csv: bad value '" + std::string(field) + "' in row "
+                                        + std::to_string(row) + ", column " + std::to_string(column));
+        }
+    }
+
+    void CheckRowComplete(size_t row, size_t last_column) const {
+        if (last_column + 1 != columns_.GetSize()) {
+            throw std::invalid_argument("csv: too few fields in row " + std::to_string(row));
+        }
+    }
+
+    SimpleVector<Column> columns_;
+    size_t rows_ = 0;
+};
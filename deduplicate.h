@@ -0,0 +1,179 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+#include "simple_vector.h"
+
+// Удаление повторов из SimpleVector на месте. Способ выбирается по данным:
+// - уже отсортированный вектор сжимается одним проходом;
+// - короткий вектор сравнивается попарно, без выделения памяти;
+// - иначе остаются первые вхождения, найденные по хэш-таблице номеров уже оставленных
+//   элементов (сами элементы в таблицу не копируются);
+// - для типов без std::hash вектор сортируется, а если порядок нужен — сортируются номера;
+//   типы без operator< и std::hash сравниваются попарно.
+// Оставленные элементы перемещаются в начало, размер уменьшается, вместимость — по запросу
+enum class DedupStrategy {
+    None,
+    SortedLinear,
+    Quadratic,
+    Sort,
+    Hash,
+};
+
+struct DedupResult {
+    DedupStrategy strategy = DedupStrategy::None;
+    size_t removed = 0;
+};
+
+namespace dedup_detail {
+
+// Векторы не длиннее этого сравниваются попарно
+constexpr size_t QUADRATIC_MAX_SIZE = 32;
+
+template <typename Type>
+concept Ordered = requires(const Type& a, const Type& b) {
+    { a < b } -> std::convertible_to<bool>;
+};
+
+template <typename Type>
+concept Hashable = requires(const Type& value) {
+    { std::hash<Type>{}(value) } -> std::convertible_to<size_t>;
+};
+
+// Сжимает отсортированный вектор, возвращает новый размер
+template <typename Type>
+size_t UniqueSorted(SimpleVector<Type>& items) {
+    return static_cast<size_t>(std::unique(items.begin(), items.end()) - items.begin());
+}
+
+template <typename Type>
+size_t UniqueQuadratic(SimpleVector<Type>& items) {
+    Type* const data = items.begin();
+    size_t kept = 0;
+    for (size_t i = 0; i < items.GetSize(); ++i) {
+        if (std::find(data, data + kept, data[i]) == data + kept) {
+            if (kept != i) {
+                data[kept] = std::move(data[i]);
+            }
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+// Слоты хранят номер оставленного элемента; элементы уже сдвинуты к началу,
+// поэтому номер указывает на его новое место
+template <typename Index, typename Type>
+size_t UniqueHashed(SimpleVector<Type>& items) {
+    constexpr Index EMPTY = std::numeric_limits<Index>::max();
+    const size_t size = items.GetSize();
+    // таблица заполняется не больше чем наполовину даже без повторов
+    const size_t slot_count = std::bit_ceil(2 * size);
+    const unsigned shift = 64 - static_cast<unsigned>(std::countr_zero(slot_count));
+    const size_t mask = slot_count - 1;
+    SimpleVector<Index> slots(slot_count);
+    std::fill(slots.begin(), slots.end(), EMPTY);
+
+    Type* const data = items.begin();
+    const std::hash<Type> hasher;
+    size_t kept = 0;
+    for (size_t i = 0; i < size; ++i) {
+        // умножение Фибоначчи: std::hash целых чисел — тождественное отображение
+        size_t slot = static_cast<size_t>((static_cast<uint64_t>(hasher(data[i])) * 0x9E3779B97F4A7C15ULL) >> shift);
+        while (slots[slot] != EMPTY && !(data[slots[slot]] == data[i])) {
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot] == EMPTY) {
+            if (kept != i) {
+                data[kept] = std::move(data[i]);
+            }
+            slots[slot] = static_cast<Index>(kept++);
+        }
+    }
+    return kept;
+}
+
+// Первые вхождения по устойчивой сортировке номеров
+template <typename Type>
+size_t UniqueSortedIndices(SimpleVector<Type>& items) {
+    const size_t size = items.GetSize();
+    Type* const data = items.begin();
+    SimpleVector<size_t> order(size);
+    for (size_t i = 0; i < size; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [data](size_t lhs, size_t rhs) {
+        return data[lhs] < data[rhs];
+    });
+    SimpleVector<char> keep(size);
+    for (size_t i = 0; i < size; ++i) {
+        keep[order[i]] = i == 0 || data[order[i - 1]] < data[order[i]];
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (keep[i]) {
+            if (kept != i) {
+                data[kept] = std::move(data[i]);
+            }
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+template <typename Type>
+std::pair<DedupStrategy, size_t> Compact(SimpleVector<Type>& items, bool keep_order) {
+    if constexpr (Ordered<Type>) {
+        if (std::is_sorted(items.begin(), items.end())) {
+            return {DedupStrategy::SortedLinear, UniqueSorted(items)};
+        }
+    }
+    if (items.GetSize() <= QUADRATIC_MAX_SIZE) {
+        return {DedupStrategy::Quadratic, UniqueQuadratic(items)};
+    }
+    // проход по хэш-таблице быстрее сортировки и при ненужном порядке
+    if constexpr (Hashable<Type>) {
+        if (items.GetSize() < std::numeric_limits<uint32_t>::max()) {
+            return {DedupStrategy::Hash, UniqueHashed<uint32_t>(items)};
+        }
+        return {DedupStrategy::Hash, UniqueHashed<size_t>(items)};
+    }
+    else if constexpr (Ordered<Type>) {
+        if (!keep_order) {
+            std::sort(items.begin(), items.end());
+            return {DedupStrategy::Sort, UniqueSorted(items)};
+        }
+        return {DedupStrategy::Sort, UniqueSortedIndices(items)};
+    }
+    else {
+        return {DedupStrategy::Quadratic, UniqueQuadratic(items)};
+    }
+}
+
+}  // namespace dedup_detail
+
+// Удаляет повторы из items. При keep_order оставшиеся элементы идут в порядке первых вхождений,
+// иначе порядок не определён.
+// Элементы сравниваются operator==; operator< и std::hash используются, если определены.
+// При shrink вместимость уменьшается до нового размера
+template <typename Type>
+DedupResult Deduplicate(SimpleVector<Type>& items, bool keep_order = true, bool shrink = false) {
+    DedupResult result;
+    const size_t size = items.GetSize();
+    if (size > 1) {
+        const auto [strategy, kept] = dedup_detail::Compact(items, keep_order);
+        result.strategy = strategy;
+        result.removed = size - kept;
+        items.Resize(kept);
+    }
+    if (shrink) {
+        items.ShrinkToFit();
+    }
+    return result;
+}
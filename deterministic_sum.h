@@ -0,0 +1,205 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Воспроизводимое суммирование double: результат не зависит от числа потоков
+// и набора SIMD-инструкций, с которым собрана программа.
+// Массив делится на блоки фиксированного размера, элемент i блока попадает в полосу i % LANES,
+// каждая полоса суммируется с компенсацией Ноймайера. Полосы блока и затем суммы блоков
+// объединяются попарным деревом, форма которого зависит только от длины массива.
+// Потоки получают непрерывные диапазоны блоков, поэтому порядок сложений один и тот же
+// при любом их числе. Векторные ядра выполняют те же операции в том же порядке,
+// что и скалярное, поэтому результаты совпадают побитово. Собирать без -ffast-math:
+// перестановка сложений компилятором разрушает и компенсацию, и воспроизводимость
+namespace deterministic_sum_detail {
+
+constexpr size_t LANES = 8;
+constexpr size_t BLOCK_SIZE = 4096;
+// Меньшие массивы суммируются в одном потоке
+constexpr size_t MIN_BLOCKS_PER_THREAD = 16;
+
+// Сумма и накопленная погрешность её округлений
+struct Partial {
+    double sum = 0.0;
+    double compensation = 0.0;
+};
+
+// Шаг Ноймайера: погрешность сложения sum + value вычисляется через большее по модулю слагаемое
+inline void Accumulate(double& sum, double& compensation, double value) noexcept {
+    const double total = sum + value;
+    const bool sum_is_bigger = std::fabs(sum) >= std::fabs(value);
+    const double big = sum_is_bigger ? sum : value;
+    const double small = sum_is_bigger ? value : sum;
+    compensation += (big - total) + small;
+    sum = total;
+}
+
+inline Partial Combine(const Partial& left, const Partial& right) noexcept {
+    Partial result = left;
+    Accumulate(result.sum, result.compensation, right.sum);
+    result.compensation += right.compensation;
+    return result;
+}
+
+// Попарное объединение partials[begin, end), форма дерева зависит только от end - begin
+inline Partial CombineRange(const Partial* partials, size_t begin, size_t end) noexcept {
+    if (end - begin == 1) {
+        return partials[begin];
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    return Combine(CombineRange(partials, begin, middle), CombineRange(partials, middle, end));
+}
+
+#if defined(__AVX2__)
+
+inline void AccumulateVector(__m256d& sum, __m256d& compensation, __m256d value) noexcept {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d total = _mm256_add_pd(sum, value);
+    const __m256d sum_is_bigger = _mm256_cmp_pd(_mm256_andnot_pd(sign, sum), _mm256_andnot_pd(sign, value),
+                                                _CMP_GE_OQ);
+    const __m256d big = _mm256_blendv_pd(value, sum, sum_is_bigger);
+    const __m256d small = _mm256_blendv_pd(sum, value, sum_is_bigger);
+    compensation = _mm256_add_pd(compensation, _mm256_add_pd(_mm256_sub_pd(big, total), small));
+    sum = total;
+}
+
+// Полные группы по LANES элементов; возвращает число обработанных элементов
+inline size_t AccumulateGroups(const double* data, size_t size, double* sums, double* compensations) noexcept {
+    __m256d sum_low = _mm256_loadu_pd(sums);
+    __m256d sum_high = _mm256_loadu_pd(sums + 4);
+    __m256d compensation_low = _mm256_loadu_pd(compensations);
+    __m256d compensation_high = _mm256_loadu_pd(compensations + 4);
+    size_t i = 0;
+    for (; i + LANES <= size; i += LANES) {
+        AccumulateVector(sum_low, compensation_low, _mm256_loadu_pd(data + i));
+        AccumulateVector(sum_high, compensation_high, _mm256_loadu_pd(data + i + 4));
+    }
+    _mm256_storeu_pd(sums, sum_low);
+    _mm256_storeu_pd(sums + 4, sum_high);
+    _mm256_storeu_pd(compensations, compensation_low);
+    _mm256_storeu_pd(compensations + 4, compensation_high);
+    return i;
+}
+
+#elif defined(__SSE2__)
+
+inline void AccumulateVector(__m128d& sum, __m128d& compensation, __m128d value) noexcept {
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d total = _mm_add_pd(sum, value);
+    const __m128d sum_is_bigger = _mm_cmpge_pd(_mm_andnot_pd(sign, sum), _mm_andnot_pd(sign, value));
+    const __m128d big = _mm_or_pd(_mm_and_pd(sum_is_bigger, sum), _mm_andnot_pd(sum_is_bigger, value));
+    const __m128d small = _mm_or_pd(_mm_and_pd(sum_is_bigger, value), _mm_andnot_pd(sum_is_bigger, sum));
+    compensation = _mm_add_pd(compensation, _mm_add_pd(_mm_sub_pd(big, total), small));
+    sum = total;
+}
+
+inline size_t AccumulateGroups(const double* data, size_t size, double* sums, double* compensations) noexcept {
+    __m128d s[LANES / 2];
+    __m128d c[LANES / 2];
+    for (size_t lane = 0; lane < LANES / 2; ++lane) {
+        s[lane] = _mm_loadu_pd(sums + 2 * lane);
+        c[lane] = _mm_loadu_pd(compensations + 2 * lane);
+    }
+    size_t i = 0;
+    for (; i + LANES <= size; i += LANES) {
+        for (size_t lane = 0; lane < LANES / 2; ++lane) {
+            AccumulateVector(s[lane], c[lane], _mm_loadu_pd(data + i + 2 * lane));
+        }
+    }
+    for (size_t lane = 0; lane < LANES / 2; ++lane) {
+        _mm_storeu_pd(sums + 2 * lane, s[lane]);
+        _mm_storeu_pd(compensations + 2 * lane, c[lane]);
+    }
+    return i;
+}
+
+#else
+
+inline size_t AccumulateGroups(const double* data, size_t size, double* sums, double* compensations) noexcept {
+    size_t i = 0;
+    for (; i + LANES <= size; i += LANES) {
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            Accumulate(sums[lane], compensations[lane], data[i + lane]);
+        }
+    }
+    return i;
+}
+
+#endif
+
+// Сумма блока из size <= BLOCK_SIZE элементов
+inline Partial SumBlock(const double* data, size_t size) noexcept {
+    double sums[LANES] = {};
+    double compensations[LANES] = {};
+    size_t i = AccumulateGroups(data, size, sums, compensations);
+    for (size_t lane = 0; i < size; ++i, ++lane) {
+        Accumulate(sums[lane], compensations[lane], data[i]);
+    }
+    Partial lanes[LANES];
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        lanes[lane] = {sums[lane], compensations[lane]};
+    }
+    return CombineRange(lanes, 0, LANES);
+}
+
+inline void SumBlocks(const double* data, size_t size, size_t first_block, size_t last_block, Partial* partials) noexcept {
+    for (size_t block = first_block; block < last_block; ++block) {
+        const size_t begin = block * BLOCK_SIZE;
+        partials[block] = SumBlock(data + begin, std::min(BLOCK_SIZE, size - begin));
+    }
+}
+
+}  // namespace deterministic_sum_detail
+
+// Сумма size чисел, вычисленная в threads потоках. Результат побитово одинаков
+// при любом threads и обычно точнее последовательного сложения.
+// Если среди чисел есть бесконечности или NaN, возвращается NaN или бесконечность, как при обычном сложении
+inline double DeterministicSum(const double* data, size_t size, size_t threads = 1) {
+    using namespace deterministic_sum_detail;
+    if (size == 0) {
+        return 0.0;
+    }
+    const size_t blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    threads = std::max<size_t>(std::min(threads, blocks / MIN_BLOCKS_PER_THREAD), 1);
+    SimpleVector<Partial> partials(blocks);
+
+    auto run_part = [&](size_t part) {
+        SumBlocks(data, size, blocks * part / threads, blocks * (part + 1) / threads, partials.begin());
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t part = 1; part < threads; ++part) {
+        try {
+            workers.emplace_back(run_part, part);
+        }
+        catch (...) {
+            // поток не создан: часть суммируется в текущем потоке
+            run_part(part);
+        }
+    }
+    run_part(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const Partial total = CombineRange(partials.begin(), 0, blocks);
+    // при переполнении погрешность бессмысленна (inf - inf)
+    if (!std::isfinite(total.sum)) {
+        return total.sum;
+    }
+    return total.sum + total.compensation;
+}
+
+inline double DeterministicSum(const SimpleVector<double>& items, size_t threads = 1) {
+    return DeterministicSum(items.begin(), items.GetSize(), threads);
+}
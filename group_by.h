@@ -0,0 +1,197 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "simple_vector.h"
+
+// Группировка столбца значений по столбцу ключей с агрегатами SUM, COUNT, MIN и MAX.
+// Хэш-таблица с открытой адресацией и линейным пробированием хранит пары
+// (ключ, номер группы) в SimpleVector, а агрегаты лежат в столбцах результата по номеру группы.
+// Входные столбцы обрабатываются пачками: сначала хэши всей пачки и, если таблица
+// не помещается в кэш, предварительная подгрузка слотов, затем поиск групп, затем обновление агрегатов
+// по найденным номерам групп. Группы идут в порядке первого появления ключа
+template <typename Value>
+struct GroupByResult {
+    // Целые суммируются в int64_t, числа с плавающей точкой — в double
+    using SumType = std::conditional_t<std::is_integral_v<Value>, int64_t, double>;
+
+    SimpleVector<int64_t> keys;
+    SimpleVector<uint64_t> counts;
+    SimpleVector<SumType> sums;
+    SimpleVector<Value> mins;
+    SimpleVector<Value> maxes;
+
+    size_t GetGroupCount() const noexcept {
+        return keys.GetSize();
+    }
+};
+
+template <typename Value>
+class GroupByAggregator {
+public:
+    using Result = GroupByResult<Value>;
+
+    static constexpr size_t BATCH_SIZE = 256;
+
+    // Резервирует место под expected_groups групп
+    explicit GroupByAggregator(size_t expected_groups = 0) {
+        Rehash(std::bit_ceil(std::max<size_t>(2 * expected_groups, MIN_SLOTS)));
+        result_.keys.Reserve(expected_groups);
+    }
+
+    // Добавляет строки keys[i], values[i].
+    // Выбрасывает std::invalid_argument, если длины столбцов различаются
+    void Add(const SimpleVector<int64_t>& keys, const SimpleVector<Value>& values) {
+        if (keys.GetSize() != values.GetSize()) {
+            throw std::invalid_argument("key and value columns have different sizes");
+        }
+        for (size_t begin = 0; begin < keys.GetSize(); begin += BATCH_SIZE) {
+            const size_t count = std::min(BATCH_SIZE, keys.GetSize() - begin);
+            AddBatch(keys.begin() + begin, values.begin() + begin, count);
+        }
+    }
+
+    size_t GetGroupCount() const noexcept {
+        return result_.GetGroupCount();
+    }
+
+    const Result& GetResult() const noexcept {
+        return result_;
+    }
+
+    // Отдаёт столбцы результата. Агрегатор становится пустым
+    Result Release() {
+        Result result = std::move(result_);
+        result_ = Result();
+        Rehash(MIN_SLOTS);
+        return result;
+    }
+
+private:
+    static constexpr size_t MIN_SLOTS = 16;
+    static constexpr size_t PREFETCH_MIN_TABLE_BYTES = 1 << 20;
+    static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        int64_t key = 0;
+        uint32_t group = EMPTY;
+    };
+
+    static uint64_t Hash(int64_t key) noexcept {
+        // умножение Фибоначчи: старшие биты произведения перемешаны лучше младших
+        return static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    size_t GetSlot(uint64_t hash) const noexcept {
+        return static_cast<size_t>(hash >> shift_);
+    }
+
+    void AddBatch(const int64_t* keys, const Value* values, size_t count) {
+        // таблица заполняется не больше чем наполовину, в том числе после всей пачки
+        if (2 * (GetGroupCount() + count) > slots_.GetSize()) {
+            Rehash(std::bit_ceil(2 * (GetGroupCount() + count)));
+        }
+        size_t slots[BATCH_SIZE];
+        for (size_t i = 0; i < count; ++i) {
+            slots[i] = GetSlot(Hash(keys[i]));
+        }
+        // подгрузка маленькой таблицы из кэша стоит дороже, чем экономит
+        if (slots_.GetSize() * sizeof(Slot) > PREFETCH_MIN_TABLE_BYTES) {
+            for (size_t i = 0; i < count; ++i) {
+                __builtin_prefetch(slots_.begin() + slots[i]);
+            }
+        }
+        uint32_t groups[BATCH_SIZE];
+        for (size_t i = 0; i < count; ++i) {
+            groups[i] = FindOrInsert(keys[i], slots[i]);
+        }
+
+        uint64_t* const counts = result_.counts.begin();
+        auto* const sums = result_.sums.begin();
+        Value* const mins = result_.mins.begin();
+        Value* const maxes = result_.maxes.begin();
+        // четыре агрегата — независимые цепочки зависимостей, поэтому обновляются в одном цикле
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t group = groups[i];
+            ++counts[group];
+            sums[group] += values[i];
+            mins[group] = std::min(mins[group], values[i]);
+            maxes[group] = std::max(maxes[group], values[i]);
+        }
+    }
+
+    uint32_t FindOrInsert(int64_t key, size_t slot) {
+        const size_t mask = slots_.GetSize() - 1;
+        const Slot* const table = slots_.begin();
+        while (table[slot].group != EMPTY) {
+            if (table[slot].key == key) {
+                return table[slot].group;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return Insert(key, slot);
+    }
+
+    // Новая группа встречается редко, поэтому вынесена из цикла поиска
+    // Столбцы растут раньше записи в слот: если PushBack выбросит bad_alloc,
+    // уже добавленные элементы снимаются, а слот не ссылается на несуществующую группу
+    [[gnu::noinline]] uint32_t Insert(int64_t key, size_t slot) {
+        const uint32_t group = static_cast<uint32_t>(GetGroupCount());
+        try {
+            result_.keys.PushBack(key);
+            result_.counts.PushBack(0);
+            result_.sums.PushBack(0);
+            result_.mins.PushBack(std::numeric_limits<Value>::max());
+            result_.maxes.PushBack(std::numeric_limits<Value>::lowest());
+        }
+        catch (...) {
+            const auto trim = [group](auto& column) noexcept {
+                if (column.GetSize() > group) {
+                    column.PopBack();
+                }
+            };
+            trim(result_.keys);
+            trim(result_.counts);
+            trim(result_.sums);
+            trim(result_.mins);
+            trim(result_.maxes);
+            throw;
+        }
+        slots_[slot] = Slot{key, group};
+        return group;
+    }
+
+    void Rehash(size_t slot_count) {
+        if (slot_count > size_t{1} << 32) {
+            throw std::length_error("too many groups");
+        }
+        slots_ = SimpleVector<Slot>(slot_count);
+        shift_ = 64 - static_cast<unsigned>(std::countr_zero(slot_count));
+        const size_t mask = slot_count - 1;
+        for (size_t group = 0; group < GetGroupCount(); ++group) {
+            size_t slot = GetSlot(Hash(result_.keys[group]));
+            while (slots_[slot].group != EMPTY) {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = Slot{result_.keys[group], static_cast<uint32_t>(group)};
+        }
+    }
+
+    SimpleVector<Slot> slots_;
+    unsigned shift_ = 64;
+    Result result_;
+};
+
+// Группирует values по keys и возвращает столбцы ключей и агрегатов
+template <typename Value>
+GroupByResult<Value> GroupBy(const SimpleVector<int64_t>& keys, const SimpleVector<Value>& values) {
+    GroupByAggregator<Value> aggregator;
+    aggregator.Add(keys, values);
+    return aggregator.Release();
+}
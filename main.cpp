@@ -1,11 +1,199 @@
 ﻿#include "simple_vector.h"
+#include "append_log.h"
+#include "async_file_loader.h"
+#include "byte_swap.h"
+#include "csv_parser.h"
+#include "deduplicate.h"
+#include "deterministic_sum.h"
+#include "group_by.h"
+#include "memory_reclaimer.h"
+#include "merge_k.h"
+#include "normalized_key_sort.h"
+#include "poly_vector.h"
+#include "prefix_sum_vector.h"
+#include "quantized_vector.h"
+#include "radix_partition.h"
+#include "rle_vector.h"
+#include "roaring_bitmap.h"
+#include "sort_tracking_vector.h"
+#include "string_builder.h"
+#include "vector_latency.h"
+#include "vector_profile.h"
+#include "vector_search.h"
+#include "vector_trace.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <new>
 #include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
+// Счётчики глобальных выделений памяти. Операторы new/delete заменены,
+// чтобы тесты могли проверять точное количество аллокаций.
+// Фоновые потоки тестов тоже выделяют память, поэтому счётчики атомарные
+atomic<size_t> allocation_count{0};
+atomic<size_t> deallocation_count{0};
+// Сколько выделений осталось до искусственного отказа, плюс один; 0 — отказов нет
+atomic<size_t> allocations_before_failure{0};
+
+// Выделение и освобождение вынесены в невстраиваемые функции: иначе GCC видит free
+// для указателя из operator new и выдаёт ложное предупреждение -Wmismatched-new-delete
+[[gnu::noinline]] void* CountedTryAllocate(size_t size, size_t alignment = 0) noexcept {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    if (allocations_before_failure.load(memory_order_relaxed) != 0
+        && allocations_before_failure.fetch_sub(1, memory_order_relaxed) == 1) {
+        return nullptr;
+    }
+    size = size == 0 ? 1 : size;
+    if (alignment == 0) {
+        return malloc(size);
+    }
+    // aligned_alloc требует размер, кратный выравниванию
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* CountedAllocate(size_t size, size_t alignment = 0) {
+    if (void* ptr = CountedTryAllocate(size, alignment)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void CountedFree(void* ptr) noexcept {
+    if (ptr) {
+        deallocation_count.fetch_add(1, memory_order_relaxed);
+        free(ptr);
+    }
+}
+
+void* operator new(size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocate(size);
+}
+
+// Без замены этих перегрузок память из них (например, временный буфер std::stable_sort)
+// освобождалась бы заменённым delete, не будучи посчитанной при выделении
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return CountedTryAllocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return CountedTryAllocate(size);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return CountedTryAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return CountedTryAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, const nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, const nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, align_val_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, align_val_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t, align_val_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t, align_val_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, align_val_t, const nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, align_val_t, const nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+// Запоминает значения счётчиков при создании и сообщает,
+// сколько выделений и освобождений произошло с этого момента
+class AllocationScope {
+public:
+    size_t GetAllocations() const {
+        return allocation_count.load(memory_order_relaxed) - allocations_;
+    }
+    size_t GetDeallocations() const {
+        return deallocation_count.load(memory_order_relaxed) - deallocations_;
+    }
+
+private:
+    size_t allocations_ = allocation_count.load(memory_order_relaxed);
+    size_t deallocations_ = deallocation_count.load(memory_order_relaxed);
+};
+
+// Пока объект жив, выделение памяти с номером successful + 1 завершится отказом
+class AllocationFailure {
+public:
+    explicit AllocationFailure(size_t successful) {
+        allocations_before_failure.store(successful + 1, memory_order_relaxed);
+    }
+    AllocationFailure(const AllocationFailure&) = delete;
+    AllocationFailure& operator=(const AllocationFailure&) = delete;
+    ~AllocationFailure() {
+        allocations_before_failure.store(0, memory_order_relaxed);
+    }
+};
+
 class X {
 public:
     X()
@@ -31,6 +219,53 @@ private:
     size_t x_;
 };
 
+struct CountedStats {
+    size_t default_constructions = 0;
+    size_t copies = 0;
+    size_t moves = 0;
+};
+
+// Тип, подсчитывающий вызовы своих конструкторов и операторов присваивания
+class Counted {
+public:
+    Counted() {
+        ++stats.default_constructions;
+    }
+    Counted(int value)
+        : value_(value) {
+    }
+    Counted(const Counted& other)
+        : value_(other.value_) {
+        ++stats.copies;
+    }
+    Counted(Counted&& other) noexcept
+        : value_(exchange(other.value_, 0)) {
+        ++stats.moves;
+    }
+    Counted& operator=(const Counted& other) {
+        value_ = other.value_;
+        ++stats.copies;
+        return *this;
+    }
+    Counted& operator=(Counted&& other) noexcept {
+        value_ = exchange(other.value_, 0);
+        ++stats.moves;
+        return *this;
+    }
+    int GetValue() const {
+        return value_;
+    }
+
+    static void ResetStats() {
+        stats = CountedStats();
+    }
+
+    inline static CountedStats stats;
+
+private:
+    int value_ = 0;
+};
+
 void TestReserveConstructor() {
     SimpleVector<int> v(Reserve(5));
     assert(v.GetCapacity() == 5);
@@ -38,6 +273,14 @@ void TestReserveConstructor() {
 }
 
 void TestReserveMethod() {
+    {
+        SimpleVector<int> v{1, 2, 3};
+        v.ResizeForOverwrite(100);
+        assert(v.GetSize() == 100 && v.GetCapacity() >= 100);
+        assert(v[0] == 1 && v[1] == 2 && v[2] == 3);
+        v.ResizeForOverwrite(2);
+        assert(v.GetSize() == 2 && v.GetCapacity() >= 100);
+    }
     {
         SimpleVector<int> v;
         // зарезервируем 5 мест в векторе
@@ -420,20 +663,1870 @@ void TestNoncopiableErase() {
     cout << "Done!" << endl << endl;
 }
 
-int main() {
-    TestReserveConstructor();
-    TestReserveMethod();
-    Test1();
-    Test2();
+void TestAllocationsOnMove() {
+    const size_t size = 1000;
+    {
+        AllocationScope scope;
+        SimpleVector<int> v(GenerateVector(size));
+        // copy elision: единственное выделение происходит внутри GenerateVector
+        assert(scope.GetAllocations() == 1);
 
-    TestTemporaryObjConstructor();
-    TestTemporaryObjOperator();
-    TestNamedMoveConstructor();
-    TestNamedMoveOperator();
-    TestNoncopiableMoveConstructor();
-    TestNoncopiablePushBack();
-    TestNoncopiableInsert();
-    TestNoncopiableErase();
+        SimpleVector<int> moved(move(v));
+        SimpleVector<int> assigned;
+        assigned = move(moved);
+        assert(scope.GetAllocations() == 1);
+        assert(scope.GetDeallocations() == 0);
+        assert(assigned.GetSize() == size);
+    }
+    {
+        SimpleVector<int> v(size);
+        AllocationScope scope;
+        v = GenerateVector(size);
+        // старый буфер освобождается, новый не копируется
+        assert(scope.GetAllocations() == 1);
+        assert(scope.GetDeallocations() == 1);
+    }
+    {
+        SimpleVector<int> v(GenerateVector(size));
+        AllocationScope scope;
+        SimpleVector<int> copy(v);
+        assert(scope.GetAllocations() == 1);
+        copy = v;
+        assert(scope.GetAllocations() == 2);
+        assert(scope.GetDeallocations() == 1);
+    }
+}
+
+void TestAllocationsOnPushBack() {
+    const int size = 8;
+    // вместимость растёт как 1, 2, 4, 8
+    {
+        SimpleVector<Counted> v;
+        Counted::ResetStats();
+        AllocationScope scope;
+        for (int i = 0; i < size; ++i) {
+            v.PushBack(Counted(i));
+        }
+        assert(scope.GetAllocations() == 4);
+        assert(scope.GetDeallocations() == 3);
+        assert(Counted::stats.default_constructions == 1 + 2 + 4 + 8);
+        // 7 перемещений при переездах и 8 при вставке
+        assert(Counted::stats.moves == 15);
+        assert(Counted::stats.copies == 0);
+    }
+    {
+        SimpleVector<Counted> v;
+        const Counted item(42);
+        Counted::ResetStats();
+        AllocationScope scope;
+        for (int i = 0; i < size; ++i) {
+            v.PushBack(item);
+        }
+        assert(scope.GetAllocations() == 4);
+        assert(Counted::stats.default_constructions == 1 + 2 + 4 + 8);
+        assert(Counted::stats.moves == 7);
+        assert(Counted::stats.copies == 8);
+    }
+    // PushBack при достаточной вместимости не выделяет память
+    {
+        SimpleVector<Counted> v(Reserve(size));
+        Counted::ResetStats();
+        AllocationScope scope;
+        for (int i = 0; i < size; ++i) {
+            v.PushBack(Counted(i));
+        }
+        assert(scope.GetAllocations() == 0);
+        assert(Counted::stats.default_constructions == 0);
+        assert(Counted::stats.moves == size);
+    }
+}
+
+void TestAllocationsOnInsert() {
+    {
+        SimpleVector<Counted> v(Reserve(4));
+        for (int i = 0; i < 4; ++i) {
+            v.PushBack(Counted(i));
+        }
+        Counted::ResetStats();
+        AllocationScope scope;
+        v.Insert(v.begin(), Counted(42));
+        assert(scope.GetAllocations() == 1);
+        assert(scope.GetDeallocations() == 1);
+        assert(Counted::stats.default_constructions == 8);
+        // 4 перемещения при переезде, 4 при сдвиге и 1 при вставке
+        assert(Counted::stats.moves == 9);
+        assert(Counted::stats.copies == 0);
+        assert(v[0].GetValue() == 42);
+        assert(v[4].GetValue() == 3);
+    }
+    {
+        SimpleVector<Counted> v(Reserve(5));
+        for (int i = 0; i < 4; ++i) {
+            v.PushBack(Counted(i));
+        }
+        const Counted item(42);
+        Counted::ResetStats();
+        AllocationScope scope;
+        v.Insert(v.begin() + 1, item);
+        assert(scope.GetAllocations() == 0);
+        assert(Counted::stats.default_constructions == 0);
+        assert(Counted::stats.moves == 3);
+        assert(Counted::stats.copies == 1);
+        assert(v[1].GetValue() == 42);
+    }
+    {
+        SimpleVector<Counted> v(Reserve(4));
+        for (int i = 0; i < 4; ++i) {
+            v.PushBack(Counted(i));
+        }
+        Counted::ResetStats();
+        AllocationScope scope;
+        v.Erase(v.begin() + 1);
+        assert(scope.GetAllocations() == 0);
+        assert(Counted::stats.moves == 2);
+        assert(Counted::stats.copies == 0);
+    }
+}
+
+void TestTraceRoundTrip() {
+    using vector_trace::Op;
+    const string path = (filesystem::temp_directory_path() / "simple_vector_trace_test.bin").string();
+    SimpleVector<int> first;
+    SimpleVector<int> second;
+
+    assert(vector_trace::StartTrace(path));
+    vector_trace::RecordOp(Op::Construct, &first, 3);
+    vector_trace::RecordOp(Op::Insert, &first, 300);
+    vector_trace::RecordOp(Op::MoveConstruct, &second, &first);
+    vector_trace::RecordOp(Op::Destroy, &first);
+    vector_trace::StopTrace();
+    // после остановки записи операции не попадают в файл
+    vector_trace::RecordOp(Op::PushBack, &first);
+
+    vector_trace::Reader reader(path);
+    assert(reader);
+    vector_trace::Record record;
+    const auto first_id = reinterpret_cast<uintptr_t>(&first);
+    const auto second_id = reinterpret_cast<uintptr_t>(&second);
+
+    assert(reader.Next(record));
+    assert(record.op == Op::Construct && record.id == first_id && record.arg == 3);
+    assert(reader.Next(record));
+    assert(record.op == Op::Insert && record.id == first_id && record.arg == 300);
+    assert(reader.Next(record));
+    assert(record.op == Op::MoveConstruct && record.id == second_id && record.arg == first_id);
+    assert(reader.Next(record));
+    assert(record.op == Op::Destroy && record.id == first_id);
+    assert(!reader.Next(record));
+
+    filesystem::remove(path);
+}
+
+void TestLatencyHistogram() {
+    using vector_latency::Histogram;
+    // нижняя граница корзины отличается от значения не более чем на 1/32
+    for (uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, ~0ull}) {
+        const uint64_t lower = Histogram::GetBucketLowerBound(Histogram::GetBucketIndex(value));
+        assert(lower <= value);
+        assert(value - lower <= value / Histogram::SUB_BUCKET_COUNT);
+        assert(Histogram::GetBucketIndex(value) < Histogram::BUCKET_COUNT);
+    }
+
+    Histogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value);
+    }
+    assert(histogram.GetCount() == 1000);
+    assert(histogram.GetMax() == 1000);
+    const uint64_t median = histogram.GetPercentile(50);
+    assert(median <= 500 && median >= 500 - 500 / Histogram::SUB_BUCKET_COUNT);
+    assert(histogram.GetPercentile(100) <= 1000 && histogram.GetPercentile(100) > 960);
+}
+
+void TestLatencySampling() {
+    using vector_latency::Op;
+    using vector_latency::SampleScope;
+    vector_latency::Reset();
+
+    vector_latency::SetSamplingRate(0);
+    for (int i = 0; i < 100; ++i) {
+        SampleScope scope(Op::Insert);
+    }
+    assert(vector_latency::Snapshot(Op::Insert).GetCount() == 0);
+
+    vector_latency::SetSamplingRate(4);
+    for (int i = 0; i < 100; ++i) {
+        SampleScope scope(Op::Insert);
+    }
+    assert(vector_latency::Snapshot(Op::Insert).GetCount() == 25);
+    assert(vector_latency::Snapshot(Op::Erase).GetCount() == 0);
+
+    vector_latency::SetSamplingRate(1);
+    thread([] {
+        for (int i = 0; i < 10; ++i) {
+            SampleScope scope(Op::Erase);
+        }
+    }).join();
+    // данные завершившегося потока сохраняются
+    assert(vector_latency::Snapshot(Op::Erase).GetCount() == 10);
+
+    vector_latency::SetSamplingRate(0);
+    vector_latency::Reset();
+    assert(vector_latency::Snapshot(Op::Insert).GetCount() == 0);
+}
+
+void TestProfileRecommendations() {
+    using namespace vector_profile;
+    Reset();
+
+    // рост без Reserve
+    for (int i = 0; i < 10; ++i) {
+        InstanceStats stats;
+        for (size_t size = 1; size <= 100; ++size) {
+            stats.OnPushBack(size);
+        }
+        for (int j = 0; j < 8; ++j) {
+            stats.OnReallocate();
+        }
+        Report(source_location::current(), stats);
+    }
+    // вставки в начало
+    {
+        InstanceStats stats;
+        for (size_t size = 0; size < 100; ++size) {
+            stats.OnInsert(0, size);
+        }
+        Report(source_location::current(), stats);
+    }
+    // правки в середине рядом друг с другом
+    {
+        InstanceStats stats;
+        for (size_t size = 10; size < 110; ++size) {
+            stats.OnInsert(5 + size % 2, size);
+        }
+        Report(source_location::current(), stats);
+    }
+    // удаления из середины
+    {
+        InstanceStats stats;
+        for (size_t size = 100; size > 0; --size) {
+            stats.OnErase(size % 2 ? size / 4 : size / 2, size);
+        }
+        Report(source_location::current(), stats);
+    }
+
+    const vector<SiteStats> sites = GetSites();
+    assert(sites.size() == 4);
+    size_t reserve_advice = 0;
+    size_t deque_advice = 0;
+    size_t gap_buffer_advice = 0;
+    size_t unordered_advice = 0;
+    for (const SiteStats& site : sites) {
+        const vector<string> advice = Recommend(site);
+        assert(advice.size() == 1);
+        if (advice[0].find("Reserve(100)") != string::npos) {
+            assert(site.instances == 10);
+            ++reserve_advice;
+        }
+        deque_advice += advice[0].find("deque") != string::npos;
+        gap_buffer_advice += advice[0].find("gap buffer") != string::npos;
+        unordered_advice += advice[0].find("PopBack") != string::npos;
+    }
+    assert(reserve_advice == 1 && deque_advice == 1 && gap_buffer_advice == 1 && unordered_advice == 1);
+
+    ostringstream report;
+    WriteReport(report);
+    assert(report.str().find("main.cpp") != string::npos);
+    Reset();
+    assert(GetSites().empty());
+
+    // потоки копят статистику в своих таблицах, отчёт сливает одно место
+    const source_location shared_site = source_location::current();
+    thread([&shared_site] {
+        InstanceStats stats;
+        stats.OnPushBack(5);
+        Report(shared_site, stats);
+    }).join();
+    Report(shared_site, InstanceStats());
+    {
+        const vector<SiteStats> merged = GetSites();
+        assert(merged.size() == 1 && merged[0].instances == 2);
+        assert(merged[0].totals.push_backs == 1 && merged[0].max_size == 5);
+    }
+
+    // после первого отчёта потока отчёты не выделяют память
+    {
+        AllocationScope scope;
+        for (int i = 0; i < 100; ++i) {
+            Report(source_location::current(), InstanceStats());
+        }
+        assert(scope.GetAllocations() == 0);
+    }
+    Reset();
+
+#ifdef SIMPLE_VECTOR_PROFILE
+    // счётчики переходят вместе с буфером к вектору, в который его перенесли
+    {
+        SimpleVector<int> source;
+        for (int i = 0; i < 100; ++i) {
+            source.PushBack(i);
+        }
+        SimpleVector<int> moved(std::move(source));
+        moved.PushBack(100);
+        SimpleVector<int> assigned;
+        assigned = std::move(moved);
+        assigned.PushBack(101);
+    }
+    {
+        const vector<SiteStats> sites_after_move = GetSites();
+        assert(sites_after_move[0].totals.push_backs == 102);
+        for (size_t i = 1; i < sites_after_move.size(); ++i) {
+            assert(sites_after_move[i].GetOperations() == 0);
+        }
+    }
+    Reset();
+#endif
+}
+
+void TestAsyncFileLoader() {
+    const string path = (filesystem::temp_directory_path() / "simple_vector_loader_test.bin").string();
+    string content;
+    for (int i = 0; i < 100000; ++i) {
+        content += static_cast<char>('a' + i % 26);
+    }
+    ofstream(path, ios::binary) << content;
+
+    for (size_t buffer_count : {1, 2, 4}) {
+        AsyncFileLoader loader(path, 4096, buffer_count);
+        SimpleVector<char> buffer;
+        string loaded;
+        size_t chunks = 0;
+        while (loader.Next(buffer)) {
+            assert(buffer.GetSize() <= 4096);
+            loaded.append(buffer.begin(), buffer.end());
+            ++chunks;
+        }
+        assert(loaded == content);
+        assert(chunks == (content.size() + 4095) / 4096);
+        // после конца файла Next продолжает возвращать false
+        assert(!loader.Next(buffer));
+    }
+
+    // загрузчик можно разрушить, не дочитав файл
+    {
+        AsyncFileLoader loader(path, 1024, 2);
+        SimpleVector<char> buffer;
+        assert(loader.Next(buffer));
+    }
+
+    ofstream(path, ios::binary | ios::trunc);
+    {
+        AsyncFileLoader loader(path);
+        SimpleVector<char> buffer;
+        assert(!loader.Next(buffer));
+    }
+    filesystem::remove(path);
+
+    try {
+        AsyncFileLoader loader(path);
+        assert(false);
+    }
+    catch (const system_error&) {
+    }
+}
+
+void TestCsvColumns() {
+    {
+        CsvColumns csv{ColumnType::Int64, ColumnType::Double, ColumnType::Int64};
+        csv.Append("1,2.5,-3\n"
+                   "\n"
+                   "-9223372036854775808,1e-3,9223372036854775807\r\n"
+                   "42,-0.125,0");
+        assert(csv.GetRowCount() == 3);
+        assert((csv.GetInt64Column(0) == SimpleVector<int64_t>{1, INT64_MIN, 42}));
+        assert((csv.GetDoubleColumn(1) == SimpleVector<double>{2.5, 1e-3, -0.125}));
+        assert((csv.GetInt64Column(2) == SimpleVector<int64_t>{-3, INT64_MAX, 0}));
+
+        try {
+            csv.GetDoubleColumn(0);
+            assert(false);
+        }
+        catch (const invalid_argument&) {
+        }
+    }
+
+    // строки длиннее блока сканирования и разделитель ';'
+    {
+        CsvColumns csv{ColumnType::Int64, ColumnType::Double};
+        string text;
+        for (int i = 0; i < 1000; ++i) {
+            text += to_string(i * 1000003) + ';' + to_string(i) + ".5\n";
+        }
+        csv.Append(text, ';');
+        assert(csv.GetRowCount() == 1000);
+        for (int i = 0; i < 1000; ++i) {
+            assert(csv.GetInt64Column(0)[i] == i * 1000003);
+            assert(csv.GetDoubleColumn(1)[i] == i + 0.5);
+        }
+    }
+
+    // разбор блоками с переносом незавершённой строки
+    {
+        CsvColumns csv{ColumnType::Int64};
+        assert(csv.AppendCompleteLines("1\n2\n3") == 4);
+        assert(csv.AppendCompleteLines("3") == 0);
+        csv.Append("34\n");
+        assert((csv.GetInt64Column(0) == SimpleVector<int64_t>{1, 2, 34}));
+
+        // '\r' в конце незавершённой строки отбрасывается так же, как перед '\n'
+        csv.Append("5\r");
+        csv.Append("6\n\r");
+        assert((csv.GetInt64Column(0) == SimpleVector<int64_t>{1, 2, 34, 5, 6}));
+    }
+
+    // ошибки не меняют уже разобранные строки
+    {
+        CsvColumns csv{ColumnType::Int64, ColumnType::Int64};
+        csv.Append("1,2\n");
+        for (const char* bad : {"3,4\n5\n", "3,4,5\n", "3,x\n", "3,\n", "3,4.5\n", "3,", "3,4\n5,\r"}) {
+            try {
+                csv.Append(bad);
+                assert(false);
+            }
+            catch (const invalid_argument&) {
+            }
+            assert(csv.GetRowCount() == 1);
+            assert((csv.GetInt64Column(1) == SimpleVector<int64_t>{2}));
+        }
+    }
+}
+
+void TestStringBuilder() {
+    {
+        StringBuilder builder;
+        builder << "id=" << 42 << ' ' << string("value=") << -1.5 << ' ' << true;
+        assert(builder.View() == "id=42 value=-1.5 true");
+        builder.Append(INT64_MIN).Append(',').Append(UINT64_MAX).Append(',').Append(short{-7});
+        assert(builder.View() == "id=42 value=-1.5 true-9223372036854775808,18446744073709551615,-7");
+    }
+
+    // числа с плавающей точкой читаются обратно без потерь
+    {
+        for (double value : {0.1, 1.0 / 3, 1e300, -2.5e-300, 123456789.0}) {
+            StringBuilder builder;
+            builder.Append(value);
+            assert(stod(string(builder.View())) == value);
+        }
+        StringBuilder builder;
+        builder.AppendFixed(3.14159, 2).Append(' ').AppendFixed(-1e20, 1);
+        assert(builder.View() == "3.14 -100000000000000000000.0");
+    }
+
+    {
+        StringBuilder builder(100);
+        assert(builder.IsEmpty() && builder.GetCapacity() == 100);
+        builder.Append("abc");
+        assert(builder.View() == "abc" && builder.GetCapacity() == 100);
+    }
+
+    // рост вместимости вдвое и передача буфера без копирования
+    {
+        StringBuilder builder;
+        string expected;
+        size_t reallocations = 0;
+        size_t capacity = builder.GetCapacity();
+        for (int i = 0; i < 10000; ++i) {
+            builder.Append(i).Append(';');
+            expected += to_string(i) + ';';
+            if (builder.GetCapacity() != capacity) {
+                assert(builder.GetCapacity() >= 2 * capacity);
+                capacity = builder.GetCapacity();
+                ++reallocations;
+            }
+        }
+        assert(builder.View() == expected);
+        assert(reallocations < 20);
+
+        const char* const data = builder.View().data();
+        SimpleVector<char> released = builder.Release();
+        assert(released.begin() == data);
+        assert(released.GetSize() == expected.size());
+        assert(builder.IsEmpty());
+    }
+}
+
+template <typename Type>
+void CheckByteSwap() {
+    // все длины хвоста и смещения начала относительно выравнивания
+    for (size_t offset = 0; offset < 3; ++offset) {
+        for (size_t count = 0; count < 100; ++count) {
+            SimpleVector<Type> items(offset + count);
+            for (size_t i = 0; i < items.GetSize(); ++i) {
+                items[i] = static_cast<Type>(0x0123456789ABCDEFull * (i + 1));
+            }
+            const SimpleVector<Type> original = items;
+            ByteSwapInPlace(items.begin() + offset, count);
+            for (size_t i = 0; i < items.GetSize(); ++i) {
+                assert(items[i] == (i < offset ? original[i] : byte_swap_detail::ByteSwapValue(original[i])));
+            }
+        }
+    }
+}
+
+void TestByteSwap() {
+    CheckByteSwap<uint16_t>();
+    CheckByteSwap<uint32_t>();
+    CheckByteSwap<uint64_t>();
+    CheckByteSwap<int32_t>();
+
+    // загрузка блоками с неполным последним элементом
+    {
+        const char data[] = {0x00, 0x00, 0x00, 0x01, 0x12, 0x34, 0x56, 0x78, static_cast<char>(0xFF), 0x00};
+        SimpleVector<uint32_t> items{7};
+        assert(AppendBigEndian(data, sizeof(data), items) == 8);
+        assert((items == SimpleVector<uint32_t>{7, 1, 0x12345678}));
+
+        char stored[12] = {};
+        StoreBigEndian(items, stored);
+        assert(memcmp(stored + 4, data, 8) == 0);
+    }
+    {
+        SimpleVector<char> bytes(64 * 8 + 3);
+        for (size_t i = 0; i < bytes.GetSize(); ++i) {
+            bytes[i] = static_cast<char>(i);
+        }
+        SimpleVector<uint64_t> items;
+        assert(AppendBigEndian(bytes, items) == 64 * 8);
+        assert(items.GetSize() == 64);
+        assert(items[1] == 0x08090A0B0C0D0E0Full);
+    }
+}
+
+// Иерархия фигур разного размера для PolyVector
+struct Shape {
+    virtual ~Shape() = default;
+    virtual double Area() const = 0;
+
+    inline static int live = 0;
+};
+
+struct Square : Shape {
+    explicit Square(double side)
+        : side(side)
+    {
+        ++live;
+    }
+    Square(const Square& other)
+        : side(other.side)
+    {
+        ++live;
+    }
+    ~Square() override {
+        --live;
+    }
+    double Area() const override {
+        return side * side;
+    }
+
+    double side;
+};
+
+// Подобъект Shape лежит не в начале объекта, а строка владеет памятью в куче
+struct Labeled {
+    virtual ~Labeled() = default;
+    string label = "a label long enough to be allocated on the heap";
+};
+
+struct LabeledRect : Labeled, Shape {
+    LabeledRect(double width, double height)
+        : width(width),
+        height(height)
+    {
+        ++live;
+    }
+    LabeledRect(LabeledRect&& other) noexcept
+        : Labeled(std::move(other)),
+        width(other.width),
+        height(other.height)
+    {
+        ++live;
+    }
+    ~LabeledRect() override {
+        --live;
+    }
+    double Area() const override {
+        return width * height;
+    }
+
+    double width;
+    double height;
+    char padding[40] = {};
+};
+
+// Копирование выбрасывает исключение после заданного числа копий
+struct FragileSquare : Square {
+    explicit FragileSquare(double side)
+        : Square(side)
+    {
+    }
+    FragileSquare(const FragileSquare& other)
+        : Square(other)
+    {
+        if (--copies_left < 0) {
+            throw runtime_error("copy failed");
+        }
+    }
+
+    inline static int copies_left = 0;
+};
+
+// Полиморфный тип, явно объявленный тривиально перемещаемым
+struct RelocatableCircle : Shape {
+    explicit RelocatableCircle(double radius)
+        : radius(radius)
+    {
+        ++live;
+    }
+    RelocatableCircle(const RelocatableCircle& other)
+        : radius(other.radius)
+    {
+        ++live;
+        ++copies;
+    }
+    ~RelocatableCircle() override {
+        --live;
+    }
+    double Area() const override {
+        return 3.0 * radius * radius;
+    }
+
+    double radius;
+    inline static int copies = 0;
+};
+
+template <>
+inline constexpr bool IS_TRIVIALLY_RELOCATABLE<RelocatableCircle> = true;
+
+void TestPolyVector() {
+    // специализированный тип переносится memcpy, без конструктора копирования
+    {
+        PolyVector<Shape> shapes;
+        const size_t capacity = shapes.GetBytesCapacity();
+        for (int i = 0; i < 1000; ++i) {
+            shapes.EmplaceBack<RelocatableCircle>(i);
+        }
+        assert(shapes.GetBytesCapacity() > capacity);
+        assert(RelocatableCircle::copies == 0 && Shape::live == 1000);
+        assert(shapes[999].Area() == 3.0 * 999 * 999);
+    }
+    assert(Shape::live == 0);
+
+    {
+        PolyVector<Shape> shapes;
+        double expected = 0;
+        for (int i = 0; i < 1000; ++i) {
+            if (i % 3 == 0) {
+                shapes.EmplaceBack<LabeledRect>(i, 2.0);
+                expected += 2.0 * i;
+            }
+            else {
+                shapes.EmplaceBack<Square>(i);
+                expected += 1.0 * i * i;
+            }
+        }
+        assert(shapes.GetSize() == 1000);
+        assert(Shape::live == 1000);
+        double total = 0;
+        for (const Shape& shape : shapes) {
+            assert(reinterpret_cast<uintptr_t>(&shape) % alignof(Shape) == 0);
+            total += shape.Area();
+        }
+        assert(total == expected);
+        assert(shapes[3].Area() == 6.0);
+        assert(dynamic_cast<LabeledRect&>(shapes[999]).label.size() > 16);
+
+        shapes.PopBack();
+        assert(shapes.GetSize() == 999 && Shape::live == 999);
+
+        PolyVector<Shape> moved(std::move(shapes));
+        assert(shapes.IsEmpty() && moved.GetSize() == 999);
+        try {
+            moved.At(999);
+            assert(false);
+        }
+        catch (const out_of_range&) {
+        }
+    }
+    assert(Shape::live == 0);
+
+    // при исключении во время роста вектор остаётся прежним
+    {
+        FragileSquare::copies_left = 1000;
+        PolyVector<Shape> shapes;
+        shapes.EmplaceBack<FragileSquare>(1);
+        shapes.EmplaceBack<FragileSquare>(2);
+        const size_t capacity = shapes.GetBytesCapacity();
+        while (shapes.GetBytesUsed() + sizeof(FragileSquare) <= capacity) {
+            shapes.EmplaceBack<FragileSquare>(3);
+        }
+        const size_t size = shapes.GetSize();
+        FragileSquare::copies_left = 1;
+        try {
+            shapes.EmplaceBack<FragileSquare>(4);
+            assert(false);
+        }
+        catch (const runtime_error&) {
+        }
+        assert(shapes.GetSize() == size);
+        assert(shapes.GetBytesCapacity() == capacity);
+        assert(shapes[1].Area() == 4.0);
+        assert(Shape::live == static_cast<int>(size));
+    }
+    assert(Shape::live == 0);
+}
+
+void TestPrefixSumVector() {
+    mt19937 rng(5);
+    SimpleVector<int64_t> values(1000);
+    for (int64_t& value : values) {
+        value = rng() % 100;
+    }
+    PrefixSumVector<int64_t> sums(values);
+    auto check = [&] {
+        int64_t expected = 0;
+        for (size_t i = 0; i < values.GetSize(); ++i) {
+            assert(sums.PrefixSum(i) == expected);
+            expected += values[i];
+            // первый индекс, на котором префикс достигает expected
+            const size_t lower = sums.LowerBound(expected);
+            assert(lower <= i && sums.PrefixSum(lower + 1) >= expected && sums.PrefixSum(lower) < expected);
+        }
+        assert(sums.PrefixSum(values.GetSize()) == expected);
+        assert(sums.LowerBound(expected + 1) == values.GetSize());
+    };
+    check();
+
+    for (int i = 0; i < 500; ++i) {
+        const size_t index = rng() % values.GetSize();
+        const int64_t value = rng() % 100;
+        if (i % 2) {
+            sums.Set(index, value);
+            values[index] = value;
+        }
+        else {
+            sums.Add(index, value);
+            values[index] += value;
+        }
+    }
+    check();
+    assert(sums.RangeSum(10, 20) == accumulate(values.begin() + 10, values.begin() + 20, int64_t{0}));
+
+    // дописывание и удаление с конца поддерживают дерево
+    PrefixSumVector<int64_t> appended;
+    for (const int64_t value : values) {
+        appended.PushBack(value);
+    }
+    for (size_t i = 0; i <= values.GetSize(); i += 7) {
+        assert(appended.PrefixSum(i) == sums.PrefixSum(i));
+    }
+    appended.PopBack();
+    appended.PushBack(1);
+    assert(appended.PrefixSum(values.GetSize()) == sums.PrefixSum(values.GetSize() - 1) + 1);
+}
+
+// Отсортированные значения без повторов: разреженные, плотные и отрезки подряд
+SimpleVector<uint32_t> MakeIdSet(mt19937& rng, uint32_t seed_offset) {
+    vector<uint32_t> ids;
+    for (int i = 0; i < 3000; ++i) {
+        ids.push_back(rng());
+    }
+    for (uint32_t value = 1 << 20; value < (1 << 20) + 200000; ++value) {
+        if (rng() % 2) {
+            ids.push_back(value);
+        }
+    }
+    for (uint32_t value = 5 << 16; value < (5 << 16) + 100000; ++value) {
+        ids.push_back(value + seed_offset * 1000);
+    }
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+    SimpleVector<uint32_t> result(ids.size());
+    copy(ids.begin(), ids.end(), result.begin());
+    return result;
+}
+
+void TestRoaringBitmap() {
+    mt19937 rng(17);
+    const SimpleVector<uint32_t> a_ids = MakeIdSet(rng, 0);
+    const SimpleVector<uint32_t> b_ids = MakeIdSet(rng, 30);
+    RoaringBitmap a(a_ids);
+    RoaringBitmap b(b_ids);
+    assert(a.GetCardinality() == a_ids.GetSize());
+    assert(a.ToVector() == a_ids);
+
+    // отказ памяти при добавлении нового ключа не рассогласует ключи и контейнеры
+    for (size_t successful = 0; successful < 2; ++successful) {
+        // новый ключ встаёт перед существующим
+        RoaringBitmap bitmap;
+        bitmap.Add(5u << 16);
+        try {
+            AllocationFailure failure(successful);
+            bitmap.Add(1);
+            assert(false);
+        }
+        catch (const bad_alloc&) {
+        }
+        assert(bitmap.Contains(5u << 16) && !bitmap.Contains(1));
+        bitmap.Add(1);
+        bitmap.Add(2);
+        assert(bitmap.ToVector() == (SimpleVector<uint32_t>{1, 2, 5u << 16}));
+    }
+
+    // добавление по одному даёт то же множество
+    {
+        RoaringBitmap added;
+        for (size_t i = a_ids.GetSize(); i > 0; --i) {
+            added.Add(a_ids[i - 1]);
+        }
+        added.Add(a_ids[0]);
+        assert(added.ToVector() == a_ids);
+    }
+
+    auto check = [&](const RoaringBitmap& lhs, const RoaringBitmap& rhs) {
+        vector<uint32_t> expected;
+        set_intersection(a_ids.begin(), a_ids.end(), b_ids.begin(), b_ids.end(), back_inserter(expected));
+        SimpleVector<uint32_t> actual = And(lhs, rhs).ToVector();
+        assert(equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+
+        expected.clear();
+        set_union(a_ids.begin(), a_ids.end(), b_ids.begin(), b_ids.end(), back_inserter(expected));
+        actual = Or(lhs, rhs).ToVector();
+        assert(equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+        assert(Or(lhs, rhs).GetCardinality() == expected.size());
+
+        expected.clear();
+        set_difference(a_ids.begin(), a_ids.end(), b_ids.begin(), b_ids.end(), back_inserter(expected));
+        actual = AndNot(lhs, rhs).ToVector();
+        assert(equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    };
+    check(a, b);
+
+    // отрезки занимают меньше памяти и дают те же результаты
+    const size_t bytes_before = a.GetSizeInBytes();
+    a.RunOptimize();
+    assert(a.GetSizeInBytes() < bytes_before);
+    assert(a.ToVector() == a_ids);
+    check(a, b);
+    b.RunOptimize();
+    check(a, b);
+
+    for (int i = 0; i < 1000; ++i) {
+        const uint32_t value = i % 2 ? a_ids[rng() % a_ids.GetSize()] : static_cast<uint32_t>(rng());
+        assert(a.Contains(value) == binary_search(a_ids.begin(), a_ids.end(), value));
+    }
+    a.Add(5 << 16);
+    assert(a.Contains(5 << 16));
+
+    try {
+        RoaringBitmap unsorted(SimpleVector<uint32_t>{1, 3, 2});
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+void TestRleVector() {
+    mt19937 rng(29);
+    SimpleVector<uint8_t> statuses;
+    RleVector<uint8_t> rle;
+    size_t runs = 0;
+    for (int run = 0; run < 300; ++run) {
+        const uint8_t status = static_cast<uint8_t>(rng() % 4);
+        const size_t length = 1 + rng() % 50;
+        runs += statuses.IsEmpty() || statuses[statuses.GetSize() - 1] != status;
+        for (size_t i = 0; i < length; ++i) {
+            statuses.PushBack(status);
+            rle.PushBack(status);
+        }
+    }
+    assert(rle.GetSize() == statuses.GetSize());
+    assert(rle.GetRunCount() == runs);
+    assert(rle.Decode() == statuses);
+    assert(RleVector<uint8_t>(statuses).GetRunCount() == runs);
+
+    for (size_t i = 0; i < statuses.GetSize(); ++i) {
+        assert(rle[i] == statuses[i]);
+    }
+    for (uint8_t status = 0; status < 5; ++status) {
+        assert(rle.Count(status) == static_cast<size_t>(count(statuses.begin(), statuses.end(), status)));
+    }
+    assert(rle.Sum() == accumulate(statuses.begin(), statuses.end(), int64_t{0}));
+    for (int i = 0; i < 100; ++i) {
+        size_t begin = rng() % (statuses.GetSize() + 1);
+        size_t end = rng() % (statuses.GetSize() + 1);
+        if (begin > end) {
+            swap(begin, end);
+        }
+        assert(rle.RangeSum(begin, end) == accumulate(statuses.begin() + begin, statuses.begin() + end, int64_t{0}));
+    }
+
+    // узкий тип не переполняет сумму
+    RleVector<uint8_t> large;
+    large.AppendRun(255, 1000000);
+    assert(large.GetRunCount() == 1 && large.Sum() == 255000000);
+    try {
+        large.At(1000000);
+        assert(false);
+    }
+    catch (const out_of_range&) {
+    }
+}
+
+void TestTransformInto() {
+    SimpleVector<int32_t> ints(1000);
+    iota(ints.begin(), ints.end(), -500);
+
+    // int32_t -> float -> int16_t в том же буфере
+    {
+        SimpleVector<int32_t> source = ints;
+        const int32_t* const data = source.begin();
+        AllocationScope scope;
+        SimpleVector<float> floats = TransformInto<float>(std::move(source), [](int32_t value) {
+            return value * 0.5f;
+        });
+        assert(source.IsEmpty() && source.GetCapacity() == 0);
+        assert(reinterpret_cast<const void*>(floats.begin()) == data);
+        assert(floats.GetSize() == 1000 && floats[0] == -250.0f && floats[999] == 249.5f);
+
+        SimpleVector<int16_t> shorts = TransformInto<int16_t>(std::move(floats), [](float value) {
+            return static_cast<int16_t>(value * 2);
+        });
+        assert(reinterpret_cast<const void*>(shorts.begin()) == data);
+        assert(shorts.GetCapacity() == 2000);
+        for (size_t i = 0; i < shorts.GetSize(); ++i) {
+            assert(shorts[i] == ints[i]);
+        }
+        // вместимость в новых элементах можно использовать без перевыделения
+        shorts.Resize(2000);
+        assert(shorts.begin() == reinterpret_cast<const int16_t*>(data));
+        assert(scope.GetAllocations() == 0 && scope.GetDeallocations() == 0);
+    }
+
+    // больший тип и нетривиальный тип требуют нового буфера
+    {
+        SimpleVector<int32_t> source = ints;
+        const int32_t* const data = source.begin();
+        SimpleVector<double> doubles = TransformInto<double>(std::move(source), [](int32_t value) {
+            return value + 0.25;
+        });
+        assert(reinterpret_cast<const void*>(doubles.begin()) != data);
+        assert(source.IsEmpty() && source.GetCapacity() == 0);
+        assert(doubles.GetSize() == 1000 && doubles[0] == -499.75);
+
+        SimpleVector<string> strings = TransformInto<string>(std::move(doubles), [](double value) {
+            return to_string(static_cast<int>(value));
+        });
+        assert(strings.GetSize() == 1000 && strings[1] == "-498");
+    }
+
+    // при исключении источник остаётся пустым
+    {
+        SimpleVector<int32_t> source = ints;
+        try {
+            TransformInto<float>(std::move(source), [](int32_t value) {
+                if (value == 0) {
+                    throw runtime_error("zero");
+                }
+                return static_cast<float>(value);
+            });
+            assert(false);
+        }
+        catch (const runtime_error&) {
+        }
+        assert(source.IsEmpty());
+    }
+}
+
+template <typename Type>
+void CheckNormalizedKeySort(mt19937& rng, Type min_value, Type max_value) {
+    uniform_int_distribution<int64_t> values(min_value, max_value);
+    SimpleVector<SimpleVector<Type>> vectors;
+    for (int i = 0; i < 2000; ++i) {
+        // короткие векторы и общие префиксы дают много равных ключей
+        SimpleVector<Type> items(rng() % 6);
+        for (Type& item : items) {
+            item = static_cast<Type>(rng() % 3 ? values(rng) % 3 : values(rng));
+        }
+        vectors.PushBack(std::move(items));
+    }
+    vectors.PushBack({min_value});
+    vectors.PushBack({});
+    vectors.PushBack({min_value, min_value});
+
+    // буферы векторов переносятся без копирования, поэтому по адресу видно устойчивость
+    vector<pair<SimpleVector<Type>, const Type*>> expected;
+    for (const auto& items : vectors) {
+        expected.emplace_back(items, items.begin());
+    }
+    stable_sort(expected.begin(), expected.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+    SimpleVector<const Type*> buffers(vectors.GetSize());
+    for (size_t i = 0; i < vectors.GetSize(); ++i) {
+        buffers[i] = vectors[i].begin();
+    }
+
+    SortByNormalizedKey(vectors);
+    for (size_t i = 0; i < vectors.GetSize(); ++i) {
+        assert(vectors[i] == expected[i].first);
+        const size_t original = static_cast<size_t>(find(buffers.begin(), buffers.end(), vectors[i].begin()) - buffers.begin());
+        const size_t expected_original = static_cast<size_t>(
+            find(buffers.begin(), buffers.end(), expected[i].second) - buffers.begin());
+        assert(vectors[i].IsEmpty() || original == expected_original);
+    }
+}
+
+void TestNormalizedKeySort() {
+    mt19937 rng(41);
+    CheckNormalizedKeySort<int>(rng, INT32_MIN, INT32_MAX);
+    CheckNormalizedKeySort<int8_t>(rng, INT8_MIN, INT8_MAX);
+    CheckNormalizedKeySort<uint16_t>(rng, 0, UINT16_MAX);
+    CheckNormalizedKeySort<int64_t>(rng, INT64_MIN, INT64_MAX);
+}
+
+void TestMergeK() {
+    mt19937 rng(47);
+    // второй элемент пары — номер прогона, сравнение только по первому проверяет устойчивость
+    using Item = pair<int, int>;
+    auto by_key = [](const Item& lhs, const Item& rhs) {
+        return lhs.first < rhs.first;
+    };
+    for (const size_t run_count : {0, 1, 2, 7, 33}) {
+        SimpleVector<SimpleVector<Item>> runs(run_count);
+        vector<Item> expected;
+        for (size_t run = 0; run < run_count; ++run) {
+            runs[run].Resize(run % 5 == 3 ? 0 : rng() % 2000);
+            for (Item& item : runs[run]) {
+                item = {static_cast<int>(rng() % 500), static_cast<int>(run)};
+            }
+            sort(runs[run].begin(), runs[run].end(), by_key);
+            expected.insert(expected.end(), runs[run].begin(), runs[run].end());
+        }
+        stable_sort(expected.begin(), expected.end(), by_key);
+
+        const SimpleVector<Item> merged = MergeK(runs, by_key);
+        assert(equal(merged.begin(), merged.end(), expected.begin(), expected.end()));
+        for (const size_t threads : {2, 4, 16}) {
+            const SimpleVector<Item> parallel = MergeKParallel(runs, threads, by_key);
+            assert(parallel == merged);
+        }
+    }
+
+    // все прогоны пусты
+    const SimpleVector<SimpleVector<int>> empty_runs(2);
+    assert(MergeK(empty_runs).IsEmpty() && MergeKParallel(empty_runs, 4).IsEmpty());
+
+    // равные ключи дают одинаковые разделители, и части параллельного слияния пусты
+    SimpleVector<SimpleVector<Item>> equal_runs(4);
+    for (size_t run = 0; run < equal_runs.GetSize(); ++run) {
+        for (int i = 0; i < 1000; ++i) {
+            equal_runs[run].PushBack({7, static_cast<int>(run)});
+        }
+    }
+    const SimpleVector<Item> equal_merged = MergeK(equal_runs, by_key);
+    assert(equal_merged.GetSize() == 4000 && is_sorted(equal_merged.begin(), equal_merged.end()));
+    for (const size_t threads : {2, 4, 16}) {
+        assert(MergeKParallel(equal_runs, threads, by_key) == equal_merged);
+    }
+}
+
+// Тривиальный кортеж: 16 байт делят кэш-линию и идут через буферы записи, 24 — нет
+template <size_t Padding>
+struct PartitionTuple {
+    uint64_t key;
+    uint32_t row;
+    uint32_t padding[Padding];
+
+    bool operator==(const PartitionTuple& other) const {
+        return key == other.key && row == other.row;
+    }
+};
+
+template <typename Tuple, typename MakeTuple, typename Key>
+void CheckRadixPartition(mt19937_64& rng, MakeTuple make_tuple, Key key) {
+    SimpleVector<Tuple> tuples(20000);
+    for (size_t i = 0; i < tuples.GetSize(); ++i) {
+        tuples[i] = make_tuple(rng(), static_cast<uint32_t>(i));
+    }
+    // один проход, несколько проходов и неполный последний проход
+    for (const auto& [radix_bits, pass_bits] : {pair{6, 8}, pair{10, 5}, pair{11, 4}}) {
+        const size_t bucket_count = size_t{1} << radix_bits;
+        SimpleVector<SimpleVector<Tuple>> expected(bucket_count);
+        for (const auto& tuple : tuples) {
+            expected[key(tuple) & (bucket_count - 1)].PushBack(tuple);
+        }
+        const auto buckets = RadixPartition(tuples, radix_bits, key, pass_bits);
+        assert(buckets.GetSize() == bucket_count);
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            assert(buckets[bucket] == expected[bucket]);
+            assert(buckets[bucket].GetCapacity() == expected[bucket].GetSize());
+        }
+    }
+}
+
+template <size_t Padding>
+void CheckRadixPartitionTuple(mt19937_64& rng) {
+    using Tuple = PartitionTuple<Padding>;
+    CheckRadixPartition<Tuple>(rng, [](uint64_t key, uint32_t row) {
+        Tuple tuple{};
+        tuple.key = key;
+        tuple.row = row;
+        return tuple;
+    }, [](const Tuple& tuple) {
+        return tuple.key;
+    });
+}
+
+void TestRadixPartition() {
+    mt19937_64 rng(59);
+    static_assert(radix_partition_detail::USE_WRITE_COMBINING<PartitionTuple<1>>);
+    static_assert(!radix_partition_detail::USE_WRITE_COMBINING<PartitionTuple<3>>);
+    CheckRadixPartitionTuple<1>(rng);
+    CheckRadixPartitionTuple<3>(rng);
+    CheckRadixPartition<pair<uint64_t, uint32_t>>(rng, [](uint64_t key, uint32_t row) {
+        return pair{key, row};
+    }, [](const pair<uint64_t, uint32_t>& tuple) {
+        return tuple.first;
+    });
+
+    // нетривиальный тип раскладывается без буферов записи
+    SimpleVector<string> words = {"a", "bb", "ccc", "dd", "e"};
+    const auto by_length = RadixPartition(words, 2, [](const string& word) {
+        return word.size();
+    });
+    assert(by_length[1] == (SimpleVector<string>{"a", "e"}));
+    assert(by_length[2] == (SimpleVector<string>{"bb", "dd"}));
+    assert(by_length[3] == SimpleVector<string>{"ccc"});
+
+    try {
+        RadixPartition(words, 0, [](const string& word) {
+            return word.size();
+        });
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+void TestGroupBy() {
+    mt19937_64 rng(67);
+    for (const uint64_t key_range : {uint64_t{7}, uint64_t{5000}, UINT64_MAX}) {
+        SimpleVector<int64_t> keys(20000);
+        SimpleVector<int32_t> values(keys.GetSize());
+        for (size_t i = 0; i < keys.GetSize(); ++i) {
+            keys[i] = static_cast<int64_t>(rng() % key_range) - 3;
+            values[i] = static_cast<int32_t>(rng());
+        }
+        const GroupByResult<int32_t> result = GroupBy(keys, values);
+
+        struct Expected {
+            size_t first_row;
+            uint64_t count = 0;
+            int64_t sum = 0;
+            int32_t min = INT32_MAX;
+            int32_t max = INT32_MIN;
+        };
+        unordered_map<int64_t, Expected> expected;
+        for (size_t i = 0; i < keys.GetSize(); ++i) {
+            Expected& group = expected.try_emplace(keys[i], Expected{i}).first->second;
+            ++group.count;
+            group.sum += values[i];
+            group.min = min(group.min, values[i]);
+            group.max = max(group.max, values[i]);
+        }
+        assert(result.GetGroupCount() == expected.size());
+        size_t previous_first_row = 0;
+        for (size_t group = 0; group < result.GetGroupCount(); ++group) {
+            const Expected& e = expected.at(result.keys[group]);
+            // группы идут в порядке первого появления ключа
+            assert(group == 0 || e.first_row > previous_first_row);
+            previous_first_row = e.first_row;
+            assert(result.counts[group] == e.count && result.sums[group] == e.sum);
+            assert(result.mins[group] == e.min && result.maxes[group] == e.max);
+        }
+
+        // по частям — тот же результат
+        GroupByAggregator<int32_t> aggregator;
+        for (size_t begin = 0; begin < keys.GetSize(); begin += 3000) {
+            const size_t end = min(begin + 3000, keys.GetSize());
+            SimpleVector<int64_t> key_chunk(end - begin);
+            SimpleVector<int32_t> value_chunk(end - begin);
+            copy(keys.begin() + begin, keys.begin() + end, key_chunk.begin());
+            copy(values.begin() + begin, values.begin() + end, value_chunk.begin());
+            aggregator.Add(key_chunk, value_chunk);
+        }
+        const GroupByResult<int32_t> chunked = aggregator.Release();
+        assert(chunked.keys == result.keys && chunked.sums == result.sums && chunked.maxes == result.maxes);
+        assert(aggregator.GetGroupCount() == 0);
+    }
+
+    const auto doubles = GroupBy(SimpleVector<int64_t>{1, 2, 1}, SimpleVector<double>{0.5, -1.0, 2.0});
+    assert(doubles.keys == (SimpleVector<int64_t>{1, 2}));
+    assert(doubles.sums == (SimpleVector<double>{2.5, -1.0}));
+    assert(doubles.mins == (SimpleVector<double>{0.5, -1.0}));
+
+    // отказ памяти при росте любого из столбцов не оставляет слот без группы
+    for (size_t successful = 0; successful < 5; ++successful) {
+        GroupByAggregator<int32_t> aggregator;
+        aggregator.Add(SimpleVector<int64_t>{1}, SimpleVector<int32_t>{10});
+        const SimpleVector<int64_t> new_key{2};
+        const SimpleVector<int32_t> new_value{20};
+        try {
+            AllocationFailure failure(successful);
+            aggregator.Add(new_key, new_value);
+            assert(false);
+        }
+        catch (const bad_alloc&) {
+        }
+        const GroupByResult<int32_t>& partial = aggregator.GetResult();
+        assert(partial.GetGroupCount() == 1 && partial.counts.GetSize() == 1 && partial.sums.GetSize() == 1);
+        assert(partial.mins.GetSize() == 1 && partial.maxes.GetSize() == 1);
+
+        aggregator.Add(SimpleVector<int64_t>{2, 2, 1}, SimpleVector<int32_t>{20, 30, 5});
+        const GroupByResult<int32_t>& full = aggregator.GetResult();
+        assert(full.keys == (SimpleVector<int64_t>{1, 2}));
+        assert(full.counts == (SimpleVector<uint64_t>{2, 2}) && full.sums == (SimpleVector<int64_t>{15, 50}));
+    }
+
+    try {
+        GroupBy(SimpleVector<int64_t>{1}, SimpleVector<double>{});
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+void TestSortTrackingVector() {
+    SortTrackingVector<int> v;
+    for (int i = 0; i < 100; ++i) {
+        v.PushBack(i / 2 * 2);
+    }
+    assert(v.IsSorted());
+    assert(v.Count(10) == 2 && v.Count(11) == 0);
+    assert(v.Find(10) == v.begin() + 10 && !v.Contains(99));
+
+    // вставка и запись на своё место порядок не нарушают
+    v.Insert(v.begin() + 12, 11);
+    v.Set(0, -1);
+    v.Erase(v.begin() + 50);
+    v.PopBack();
+    assert(v.IsSorted());
+    assert(v.Count(11) == 1 && *v.Find(11) == 11 && v.Find(-1) == v.begin());
+
+    v.Set(5, 1000);
+    assert(!v.IsSorted());
+    assert(v.Contains(1000) && v.Count(1000) == 1 && v.Find(1000) == v.begin() + 5);
+    v.Set(5, 4);
+    assert(!v.IsSorted() && v.CheckSorted());
+
+    v.Insert(v.begin(), 7);
+    assert(!v.IsSorted() && v.Find(7) == v.begin());
+    v.Sort();
+    assert(v.IsSorted() && is_sorted(v.begin(), v.end()) && v.Count(7) == 1 && v.Count(6) == 2);
+
+    v.Mutate()[0] = -5;
+    assert(!v.IsSorted() && v.CheckSorted());
+    v.PushBack(-10);
+    assert(!v.IsSorted());
+    v.Clear();
+    assert(v.IsSorted());
+
+    SortTrackingVector<string, greater<string>> names(SimpleVector<string>{"c", "b", "a"});
+    assert(names.IsSorted() && names.Contains("b") && !names.Contains("d"));
+    names.PushBack("z");
+    assert(!names.IsSorted() && names.Contains("z"));
+
+    // сравнение по десяткам: эквивалентные элементы не обязательно равны
+    const auto by_tens = [](int lhs, int rhs) {
+        return lhs / 10 < rhs / 10;
+    };
+    SortTrackingVector<int, decltype(by_tens)> tens(SimpleVector<int>{1, 12, 15, 12, 27}, by_tens);
+    assert(tens.IsSorted());
+    for (int value : {1, 12, 15, 13, 27, 20}) {
+        assert(tens.Contains(value) == (tens.Count(value) > 0));
+    }
+    assert(tens.Find(15) == tens.begin() + 2 && tens.Count(12) == 2 && !tens.Contains(13));
+}
+
+void TestMemoryReclaimer() {
+    using namespace memory_reclaimer;
+    const size_t enrolled = GetEnrolledCount();
+    const ReclaimStats before = GetReclaimStats();
+    {
+        ReclaimableVector<int> small;
+        ReclaimableVector<int64_t> large(SimpleVector<int64_t>(10));
+        {
+            auto items = small.Lock();
+            items->Reserve(1000);
+            for (int i = 0; i < 10; ++i) {
+                items->PushBack(i);
+            }
+            large.Lock()->Reserve(100);
+        }
+        assert(GetEnrolledCount() == enrolled + 2);
+
+        // к векторам обращались только что
+        ReclaimStats pass = ReclaimIdle(chrono::hours(1));
+        assert(pass.vectors_shrunk == 0 && pass.skipped_recent == 2);
+
+        pass = ReclaimIdle();
+        assert(pass.passes == 1 && pass.vectors_shrunk == 2);
+        assert(pass.bytes_reclaimed == 990 * sizeof(int) + 90 * sizeof(int64_t));
+        {
+            auto items = small.Lock();
+            assert(items->GetCapacity() == 10 && items->GetSize() == 10 && (*items)[9] == 9);
+            assert(large.Lock()->GetCapacity() == 10);
+        }
+
+        // вектор, заблокированный другим потоком, пропускается
+        small.Lock()->Reserve(100);
+        promise<void> locked;
+        promise<void> release;
+        thread holder([&] {
+            auto items = small.Lock();
+            locked.set_value();
+            release.get_future().wait();
+        });
+        locked.get_future().wait();
+        pass = ReclaimIdle();
+        assert(pass.skipped_busy == 1 && pass.vectors_shrunk == 0);
+        release.set_value();
+        holder.join();
+        pass = ReclaimIdle();
+        assert(pass.vectors_shrunk == 1 && pass.bytes_reclaimed == 90 * sizeof(int));
+        assert(pass.skipped_busy == 0);
+    }
+    assert(GetEnrolledCount() == enrolled);
+    const ReclaimStats after = GetReclaimStats();
+    assert(after.passes == before.passes + 4);
+    assert(after.vectors_shrunk == before.vectors_shrunk + 3);
+    assert(after.bytes_reclaimed == before.bytes_reclaimed + 990 * sizeof(int) + 90 * sizeof(int64_t) + 90 * sizeof(int));
+
+    // давление по файлам cgroup v2
+    const filesystem::path dir = filesystem::temp_directory_path() / "simple_vector_cgroup_test";
+    filesystem::create_directories(dir);
+    auto write_files = [&dir](int high, double avg10) {
+        ofstream(dir / "memory.events") << "low 0\nhigh " << high << "\nmax 0\noom 0\noom_kill 0\n";
+        ofstream(dir / "memory.pressure") << "some avg10=" << avg10 << " avg60=0.00 avg300=0.00 total=100\n"
+                                          << "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+    };
+    write_files(5, 0.0);
+    PressureMonitor monitor(dir.string(), 10.0);
+    assert(!monitor.CheckPressure());
+    write_files(6, 0.0);
+    assert(monitor.CheckPressure());
+    assert(!monitor.CheckPressure());
+    write_files(6, 25.5);
+    assert(monitor.CheckPressure());
+    write_files(6, 9.99);
+    assert(!monitor.CheckPressure());
+
+    // фоновый поток уменьшает вектор при росте счётчика
+    {
+        ReclaimableVector<int> v;
+        v.Lock()->Reserve(64);
+        ReclaimerOptions options;
+        options.cgroup_dir = dir.string();
+        options.poll_interval = chrono::milliseconds(1);
+        options.min_idle = chrono::milliseconds(0);
+        MemoryReclaimer reclaimer(options);
+        write_files(7, 0.0);
+        for (int i = 0; i < 5000 && v.Lock()->GetCapacity() != 0; ++i) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        assert(v.Lock()->GetCapacity() == 0);
+        assert(reclaimer.GetPressureCount() >= 1);
+    }
+    filesystem::remove_all(dir);
+
+    // без файлов cgroup давления нет
+    PressureMonitor missing((dir / "missing").string());
+    assert(!missing.CheckPressure());
+}
+
+void TestDeterministicSum() {
+    assert(DeterministicSum(SimpleVector<double>()) == 0.0);
+    assert(DeterministicSum(SimpleVector<double>{1.5, 2.25, -0.75}) == 3.0);
+
+    // порядок величин сильно различается, длина не кратна блоку
+    mt19937_64 rng(121);
+    SimpleVector<double> values(300007);
+    for (double& value : values) {
+        const int64_t mantissa = static_cast<int64_t>(rng() >> 12) - (int64_t{1} << 51);
+        value = ldexp(static_cast<double>(mantissa), static_cast<int>(rng() % 80) - 40);
+    }
+    const double single = DeterministicSum(values);
+    for (size_t threads = 2; threads <= 8; ++threads) {
+        const double parallel = DeterministicSum(values, threads);
+        assert(memcmp(&parallel, &single, sizeof(double)) == 0);
+    }
+
+    // единицы теряются при обычном сложении с 1e16, но не при компенсированном
+    SimpleVector<double> ones(100000, 1.0);
+    ones[0] = 1e16;
+    ones.PushBack(-1e16);
+    double naive = 0.0;
+    for (const double value : ones) {
+        naive += value;
+    }
+    assert(naive != 99999.0);
+    assert(DeterministicSum(ones) == 99999.0 && DeterministicSum(ones, 4) == 99999.0);
+
+    ones.PushBack(numeric_limits<double>::infinity());
+    assert(DeterministicSum(ones) == numeric_limits<double>::infinity());
+    ones.PushBack(-numeric_limits<double>::infinity());
+    assert(isnan(DeterministicSum(ones)));
+}
+
+template <Quantization Format>
+void CheckQuantized(const SimpleVector<float>& values, const SimpleVector<float>& query) {
+    const QuantizedVector<Format> quantized(values);
+    assert(quantized.GetSize() == values.GetSize());
+    const SimpleVector<float> decoded = quantized.Decode();
+    double dot = 0.0;
+    double dot_bound = 0.0;
+    for (size_t i = 0; i < values.GetSize(); ++i) {
+        const float value = values[i];
+        double bound = 0.0;
+        if constexpr (Format == Quantization::Float16) {
+            bound = max(fabs(value) * 0x1p-11, 0x1p-25);
+        }
+        else if constexpr (Format == Quantization::BFloat16) {
+            bound = fabs(value) * 0x1p-8;
+        }
+        else {
+            const size_t block = i / quantized_detail::INT8_BLOCK_SIZE * quantized_detail::INT8_BLOCK_SIZE;
+            float max_magnitude = 0.0f;
+            for (size_t j = block; j < min(block + quantized_detail::INT8_BLOCK_SIZE, values.GetSize()); ++j) {
+                max_magnitude = max(max_magnitude, fabs(values[j]));
+            }
+            bound = max_magnitude / 127.0 / 2.0 * 1.0001;
+        }
+        assert(fabs(static_cast<double>(quantized[i]) - value) <= bound);
+        // векторное восстановление совпадает со скалярным
+        assert(decoded[i] == quantized[i]);
+        dot += static_cast<double>(values[i]) * query[i];
+        dot_bound += bound * fabs(query[i]) + 1e-5 * fabs(static_cast<double>(values[i]) * query[i]);
+    }
+    assert(fabs(quantized.Dot(query) - dot) <= dot_bound);
+
+    // диапазоны, не выровненные по блокам
+    for (const auto& [begin, count] : {pair<size_t, size_t>{3, 70}, {31, 1}, {40, 0}, {17, 100}}) {
+        SimpleVector<float> part(count);
+        quantized.Decode(begin, count, part.begin());
+        double part_dot = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            assert(part[i] == quantized[begin + i]);
+            part_dot += static_cast<double>(part[i]) * query[i];
+        }
+        assert(fabs(quantized.Dot(begin, query.begin(), count) - part_dot) <= 1e-4 * (1.0 + fabs(part_dot)));
+    }
+    try {
+        quantized.Dot(values.GetSize() - 5, query.begin(), 6);
+        assert(false);
+    }
+    catch (const out_of_range&) {
+    }
+}
+
+void TestQuantizedVector() {
+    using namespace quantized_detail;
+    // все конечные числа половинной точности переживают преобразование туда и обратно
+    for (uint32_t half = 0; half <= 0xffff; ++half) {
+        if ((half & 0x7c00) != 0x7c00 || (half & 0x3ff) == 0) {
+            assert(FloatToHalf(HalfToFloat(static_cast<uint16_t>(half))) == half);
+        }
+    }
+    assert(HalfToFloat(0x3c00) == 1.0f && HalfToFloat(0x0001) == 0x1p-24f && HalfToFloat(0xc000) == -2.0f);
+    // половина шага округляется к чётной мантиссе
+    assert(FloatToHalf(1.0f + 0x1p-11f) == 0x3c00 && FloatToHalf(1.0f + 3 * 0x1p-11f) == 0x3c02);
+    assert(FloatToHalf(65504.0f) == 0x7bff && FloatToHalf(65520.0f) == 0x7c00 && FloatToHalf(-1e10f) == 0xfc00);
+    assert(isnan(HalfToFloat(FloatToHalf(numeric_limits<float>::quiet_NaN()))));
+    assert(FloatToBFloat16(1.0f + 0x1p-8f) == 0x3f80 && FloatToBFloat16(1.0f + 3 * 0x1p-8f) == 0x3f82);
+    assert(BFloat16ToFloat(FloatToBFloat16(-3.5f)) == -3.5f);
+
+    mt19937 rng(122);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    SimpleVector<float> values(1000);
+    SimpleVector<float> query(values.GetSize());
+    for (size_t i = 0; i < values.GetSize(); ++i) {
+        // блоки с разным порядком величин, в том числе нулевой блок
+        const float magnitude = i / 32 == 5 ? 0.0f : ldexp(1.0f, static_cast<int>(i / 32 % 9) - 4);
+        values[i] = distribution(rng) * magnitude;
+        query[i] = distribution(rng);
+    }
+    values[100] = 1e-7f;
+    CheckQuantized<Quantization::Float16>(values, query);
+    CheckQuantized<Quantization::BFloat16>(values, query);
+    CheckQuantized<Quantization::Int8>(values, query);
+
+    assert(QuantizedVector<Quantization::Float16>(values).GetSizeInBytes() == 2000);
+    assert(QuantizedVector<Quantization::Int8>(values).GetSizeInBytes() == 1000 + 32 * sizeof(float));
+    assert(QuantizedVector<Quantization::Int8>().Decode().IsEmpty());
+
+    values[7] = numeric_limits<float>::infinity();
+    assert(isinf(QuantizedVector<Quantization::BFloat16>(values)[7]));
+    try {
+        QuantizedVector<Quantization::Int8> invalid(values);
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+}
+
+void TestVectorSearch() {
+    mt19937 rng(123);
+    uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (const size_t dim : {1, 7, 16, 33}) {
+        const size_t row_count = 1003;
+        SimpleVector<float> rows(row_count * dim);
+        for (float& value : rows) {
+            value = distribution(rng);
+        }
+        // нулевая строка и повтор строки 0 для проверки равных расстояний
+        fill(rows.begin() + 5 * dim, rows.begin() + 6 * dim, 0.0f);
+        copy(rows.begin(), rows.begin() + dim, rows.begin() + 9 * dim);
+        SimpleVector<float> query(dim);
+        for (float& value : query) {
+            value = distribution(rng);
+        }
+
+        for (const Metric metric : {Metric::L2, Metric::Dot, Metric::Cosine}) {
+            SimpleVector<float> distances(row_count);
+            ComputeDistances(rows, dim, query, metric, 0, row_count, distances.begin());
+            for (size_t row = 0; row < row_count; ++row) {
+                double dot = 0.0;
+                double l2 = 0.0;
+                double norm = 0.0;
+                double query_norm = 0.0;
+                for (size_t i = 0; i < dim; ++i) {
+                    const double x = rows[row * dim + i];
+                    dot += x * query[i];
+                    l2 += (x - query[i]) * (x - query[i]);
+                    norm += x * x;
+                    query_norm += static_cast<double>(query[i]) * query[i];
+                }
+                double expected = l2;
+                if (metric == Metric::Dot) {
+                    expected = -dot;
+                }
+                else if (metric == Metric::Cosine) {
+                    expected = norm > 0.0 ? 1.0 - dot / sqrt(norm * query_norm) : 1.0;
+                }
+                assert(fabs(distances[row] - expected) <= 1e-5 * (1.0 + dim));
+            }
+            assert(distances[9] == distances[0]);
+
+            // ответ совпадает с полной сортировкой по (расстояние, строка)
+            SimpleVector<size_t> order(row_count);
+            iota(order.begin(), order.end(), 0);
+            sort(order.begin(), order.end(), [&distances](size_t lhs, size_t rhs) {
+                return pair(distances[lhs], lhs) < pair(distances[rhs], rhs);
+            });
+            for (const size_t k : {1, 10, 300}) {
+                const SimpleVector<SearchHit> hits = SearchTopK(rows, dim, query, k, metric);
+                assert(hits.GetSize() == k);
+                for (size_t i = 0; i < k; ++i) {
+                    assert(hits[i].row == order[i] && hits[i].distance == distances[order[i]]);
+                }
+            }
+            assert(SearchTopK(rows, dim, query, 5000, metric).GetSize() == row_count);
+            assert(SearchTopK(rows, dim, query, 0, metric).IsEmpty());
+        }
+    }
+
+    TopKSelector selector(2);
+    selector.Push(0, 3.0f);
+    selector.Push(1, numeric_limits<float>::quiet_NaN());
+    assert(!selector.IsFull() && selector.GetThreshold() == numeric_limits<float>::infinity());
+    selector.Push(2, 1.0f);
+    selector.Push(3, 2.0f);
+    selector.Push(4, 2.0f);
+    assert(selector.IsFull() && selector.GetThreshold() == 2.0f);
+    const SimpleVector<SearchHit> hits = selector.Take();
+    assert(hits.GetSize() == 2 && hits[0].row == 2 && hits[1].row == 3);
+    assert(!selector.IsFull() && selector.Take().IsEmpty());
+
+    try {
+        SearchTopK(SimpleVector<float>(10), 3, SimpleVector<float>(3), 1, Metric::L2);
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+    try {
+        float out[2];
+        ComputeDistances(SimpleVector<float>(9), 3, SimpleVector<float>(3), Metric::Dot, 2, 2, out);
+        assert(false);
+    }
+    catch (const out_of_range&) {
+    }
+}
+
+struct AuditRecord {
+    uint64_t id = 0;
+    int32_t user = 0;
+    int32_t action = 0;
+};
+
+void TestAppendLog() {
+    assert(append_log_detail::Crc32c("123456789", 9) == 0xE3069283u);
+    assert(append_log_detail::Crc32c("", 0) == 0);
+
+    const string path = (filesystem::temp_directory_path() / "simple_vector_append_log_test.bin").string();
+    filesystem::remove(path);
+    const size_t header_size = append_log_detail::HEADER_SIZE;
+    const size_t frame_size = sizeof(uint32_t) + sizeof(AuditRecord);
+    {
+        AppendLog<AuditRecord> log(path, 4);
+        assert(log.IsEmpty() && filesystem::file_size(path) == header_size);
+        for (uint64_t i = 0; i < 10; ++i) {
+            log.Append({i, static_cast<int32_t>(i % 3), static_cast<int32_t>(i * 7)});
+        }
+        // два полных пакета зафиксированы, два последних ждут
+        assert(log.GetSize() == 10 && log.GetDurableSize() == 8);
+        assert(filesystem::file_size(path) == header_size + 8 * frame_size);
+        log.Commit();
+        assert(log.GetDurableSize() == 10 && filesystem::file_size(path) == header_size + 10 * frame_size);
+        log.Append({10, 1, 70});
+    }
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.GetSize() == 11 && log.GetDurableSize() == 11 && log.GetTruncatedBytes() == 0);
+        for (uint64_t i = 0; i < 11; ++i) {
+            assert(log[i].id == i && log[i].action == static_cast<int32_t>(i * 7));
+        }
+    }
+
+    // недописанный кадр после сбоя отрезается
+    {
+        ofstream(path, ios::binary | ios::app) << string(frame_size - 3, 'x');
+    }
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.GetSize() == 11 && log.GetTruncatedBytes() == frame_size - 3);
+        assert(filesystem::file_size(path) == header_size + 11 * frame_size);
+        log.Append({11, 2, 77});
+    }
+    // испорченная запись отрезается вместе со всем, что после неё
+    {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekp(static_cast<streamoff>(header_size + 9 * frame_size + 6));
+        file.put('\x5a');
+    }
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.GetSize() == 9 && log.GetTruncatedBytes() == 3 * frame_size);
+        assert(log.GetRecords()[8].id == 8);
+        log.Append({9, 0, 0});
+        log.Commit();
+        assert(log.GetDurableSize() == 10);
+    }
+
+    // журнал из нескольких кусков чтения с испорченной записью в середине
+    const size_t chunk_frames = append_log_detail::RECOVER_CHUNK_SIZE / frame_size;
+    filesystem::remove(path);
+    {
+        AppendLog<AuditRecord> log(path, 1000);
+        for (uint64_t i = 0; i < 3 * chunk_frames + 5; ++i) {
+            log.Append({i, 0, static_cast<int32_t>(i)});
+        }
+    }
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.GetSize() == 3 * chunk_frames + 5 && log.GetTruncatedBytes() == 0);
+        for (size_t i = 0; i < log.GetSize(); ++i) {
+            assert(log[i].id == i && log[i].action == static_cast<int32_t>(i));
+        }
+    }
+    {
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekp(static_cast<streamoff>(header_size + (2 * chunk_frames + 1) * frame_size + 9));
+        file.put('\x5a');
+    }
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.GetSize() == 2 * chunk_frames + 1);
+        assert(log.GetTruncatedBytes() == (chunk_frames + 4) * frame_size);
+        assert(log[2 * chunk_frames].id == 2 * chunk_frames);
+    }
+    filesystem::remove(path);
+    {
+        AppendLog<AuditRecord> log(path);
+        for (uint64_t i = 0; i < 10; ++i) {
+            log.Append({i, 0, 0});
+        }
+    }
+
+    // файл для записей другого размера и чужой файл не трогаются
+    try {
+        AppendLog<uint64_t> wrong(path);
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+    assert(filesystem::file_size(path) == header_size + 10 * frame_size);
+    ofstream(path, ios::binary | ios::trunc) << "not a log at all";
+    try {
+        AppendLog<AuditRecord> foreign(path);
+        assert(false);
+    }
+    catch (const invalid_argument&) {
+    }
+    // сбой во время записи заголовка
+    ofstream(path, ios::binary | ios::trunc) << "SVAP";
+    {
+        AppendLog<AuditRecord> log(path);
+        assert(log.IsEmpty() && log.GetTruncatedBytes() == 4);
+    }
+    filesystem::remove(path);
+
+    try {
+        AppendLog<AuditRecord> log((filesystem::temp_directory_path() / "missing_dir" / "log.bin").string());
+        assert(false);
+    }
+    catch (const system_error&) {
+    }
+}
+
+// Тип без operator< и std::hash: повторы ищутся только попарным сравнением
+struct Tag {
+    int value = 0;
+
+    bool operator==(const Tag&) const = default;
+};
+
+// Тип без std::hash: первые вхождения ищутся сортировкой номеров
+struct Version {
+    int major = 0;
+    int minor = 0;
+
+    auto operator<=>(const Version&) const = default;
+};
+
+void TestDeduplicate() {
+    mt19937 rng(125);
+    SimpleVector<int> values(1000);
+    for (int& value : values) {
+        value = static_cast<int>(rng() % 300);
+    }
+    SimpleVector<int> first_occurrences;
+    for (const int value : values) {
+        if (find(first_occurrences.begin(), first_occurrences.end(), value) == first_occurrences.end()) {
+            first_occurrences.PushBack(value);
+        }
+    }
+    SimpleVector<int> sorted_unique = first_occurrences;
+    sort(sorted_unique.begin(), sorted_unique.end());
+
+    SimpleVector<int> ordered = values;
+    DedupResult result = Deduplicate(ordered);
+    assert(result.strategy == DedupStrategy::Hash && result.removed == 1000 - first_occurrences.GetSize());
+    assert(ordered == first_occurrences && ordered.GetCapacity() == 1000);
+
+    SimpleVector<int> shrunk = values;
+    result = Deduplicate(shrunk, false, true);
+    assert(result.strategy == DedupStrategy::Hash && shrunk.GetCapacity() == shrunk.GetSize());
+    sort(shrunk.begin(), shrunk.end());
+    assert(shrunk == sorted_unique);
+
+    // уже отсортированный вектор сжимается одним проходом и при keep_order
+    SimpleVector<int> sorted = values;
+    sort(sorted.begin(), sorted.end());
+    result = Deduplicate(sorted);
+    assert(result.strategy == DedupStrategy::SortedLinear && sorted == sorted_unique);
+
+    SimpleVector<int> small{3, 1, 3, 2, 1, 3};
+    result = Deduplicate(small);
+    assert(result.strategy == DedupStrategy::Quadratic && result.removed == 3);
+    assert((small == SimpleVector<int>{3, 1, 2}));
+
+    SimpleVector<int> single{7};
+    assert(Deduplicate(single).strategy == DedupStrategy::None && single.GetSize() == 1);
+
+    SimpleVector<string> words;
+    for (int i = 0; i < 200; ++i) {
+        words.PushBack("w" + to_string((i * 37) % 50));
+    }
+    result = Deduplicate(words);
+    assert(result.strategy == DedupStrategy::Hash && words.GetSize() == 50);
+    assert(words[0] == "w0" && words[1] == "w37" && words[49] == "w13");
+
+    SimpleVector<Version> versions;
+    for (int i = 0; i < 100; ++i) {
+        versions.PushBack({(i * 7) % 5, i % 2});
+    }
+    result = Deduplicate(versions);
+    assert(result.strategy == DedupStrategy::Sort && versions.GetSize() == 10);
+    assert(versions[0].major == 0 && versions[0].minor == 0 && versions[1].major == 2 && versions[1].minor == 1);
+    for (int i = 0; i < 100; ++i) {
+        versions.PushBack({i % 3, 0});
+    }
+    result = Deduplicate(versions, false);
+    assert(result.strategy == DedupStrategy::Sort && versions.GetSize() == 10);
+    assert(is_sorted(versions.begin(), versions.end()));
+
+    SimpleVector<Tag> tags;
+    for (int i = 0; i < 100; ++i) {
+        tags.PushBack({i % 40});
+    }
+    result = Deduplicate(tags, false, true);
+    assert(result.strategy == DedupStrategy::Quadratic && tags.GetSize() == 40 && tags.GetCapacity() == 40);
+    assert(tags[39].value == 39);
+}
+
+int main() {
+    TestReserveConstructor();
+    TestReserveMethod();
+    Test1();
+    Test2();
+
+    TestTemporaryObjConstructor();
+    TestTemporaryObjOperator();
+    TestNamedMoveConstructor();
+    TestNamedMoveOperator();
+    TestNoncopiableMoveConstructor();
+    TestNoncopiablePushBack();
+    TestNoncopiableInsert();
+    TestNoncopiableErase();
+
+    TestAllocationsOnMove();
+    TestAllocationsOnPushBack();
+    TestAllocationsOnInsert();
+
+    TestTraceRoundTrip();
+    TestLatencyHistogram();
+    TestLatencySampling();
+    TestProfileRecommendations();
+    TestAsyncFileLoader();
+    TestCsvColumns();
+    TestStringBuilder();
+    TestByteSwap();
+    TestPolyVector();
+    TestPrefixSumVector();
+    TestRoaringBitmap();
+    TestRleVector();
+    TestTransformInto();
+    TestNormalizedKeySort();
+    TestMergeK();
+    TestRadixPartition();
+    TestGroupBy();
+    TestSortTrackingVector();
+    TestMemoryReclaimer();
+    TestDeterministicSum();
+    TestQuantizedVector();
+    TestVectorSearch();
+    TestAppendLog();
+    TestDeduplicate();
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,414 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "simple_vector.h"
+
+// Возврат простаивающей вместимости векторов при нехватке памяти.
+// Векторы, обёрнутые в ReclaimableVector, записываются в общий реестр.
+// ReclaimIdle уменьшает вместимость до размера у векторов, к которым давно не обращались,
+// а MemoryReclaimer делает это в фоновом потоке, когда PressureMonitor видит давление
+// на память по файлам cgroup v2 memory.events и memory.pressure (PSI).
+//
+// Правила потокобезопасности:
+// - к элементам обращаются только через Lock(): пока жив Access, вектор заблокирован
+//   и реестр его не трогает;
+// - проход реестра не ждёт занятые векторы, а пропускает их (try_lock), поэтому
+//   создавать и разрушать векторы можно и с заблокированными Access;
+// - разрушать ReclaimableVector, пока жив его Access, нельзя
+namespace memory_reclaimer {
+
+using Clock = std::chrono::steady_clock;
+
+// Итоги прохода или сумма всех проходов
+struct ReclaimStats {
+    uint64_t passes = 0;
+    uint64_t vectors_shrunk = 0;
+    uint64_t bytes_reclaimed = 0;
+    // Векторы, заблокированные во время прохода
+    uint64_t skipped_busy = 0;
+    // Векторы, к которым обращались позже порога простоя
+    uint64_t skipped_recent = 0;
+};
+
+namespace detail {
+
+enum class Outcome {
+    Shrunk,
+    Busy,
+    Recent,
+    Fitted,
+};
+
+class Enrolled {
+public:
+    // Уменьшает вместимость, если вектор свободен и не использовался с idle_before.
+    // Число освобождённых байт записывает в bytes
+    virtual Outcome TryReclaim(Clock::time_point idle_before, uint64_t& bytes) = 0;
+
+protected:
+    ~Enrolled() = default;
+
+private:
+    friend class Registry;
+
+    // Позиция в реестре, меняется только под его мьютексом
+    size_t index_ = 0;
+};
+
+class Registry {
+public:
+    // Экземпляр не разрушается: статические векторы выписываются после выхода из main
+    static Registry& Instance() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    void Enrol(Enrolled* entry) {
+        std::lock_guard guard(mutex_);
+        entry->index_ = entries_.size();
+        entries_.push_back(entry);
+    }
+
+    // Удаляет запись обменом с последней, поэтому порядок записей не сохраняется
+    void Withdraw(Enrolled* entry) noexcept {
+        std::lock_guard guard(mutex_);
+        Enrolled* last = entries_.back();
+        last->index_ = entry->index_;
+        entries_[entry->index_] = last;
+        entries_.pop_back();
+    }
+
+    size_t GetSize() {
+        std::lock_guard guard(mutex_);
+        return entries_.size();
+    }
+
+    ReclaimStats ReclaimIdle(Clock::duration min_idle) {
+        ReclaimStats pass;
+        pass.passes = 1;
+        const Clock::time_point idle_before = Clock::now() - min_idle;
+        {
+            std::lock_guard guard(mutex_);
+            for (Enrolled* entry : entries_) {
+                uint64_t bytes = 0;
+                switch (entry->TryReclaim(idle_before, bytes)) {
+                case Outcome::Shrunk:
+                    ++pass.vectors_shrunk;
+                    pass.bytes_reclaimed += bytes;
+                    break;
+                case Outcome::Busy:
+                    ++pass.skipped_busy;
+                    break;
+                case Outcome::Recent:
+                    ++pass.skipped_recent;
+                    break;
+                case Outcome::Fitted:
+                    break;
+                }
+            }
+        }
+        passes_.fetch_add(pass.passes, std::memory_order_relaxed);
+        vectors_shrunk_.fetch_add(pass.vectors_shrunk, std::memory_order_relaxed);
+        bytes_reclaimed_.fetch_add(pass.bytes_reclaimed, std::memory_order_relaxed);
+        skipped_busy_.fetch_add(pass.skipped_busy, std::memory_order_relaxed);
+        skipped_recent_.fetch_add(pass.skipped_recent, std::memory_order_relaxed);
+        return pass;
+    }
+
+    ReclaimStats GetStats() const noexcept {
+        ReclaimStats stats;
+        stats.passes = passes_.load(std::memory_order_relaxed);
+        stats.vectors_shrunk = vectors_shrunk_.load(std::memory_order_relaxed);
+        stats.bytes_reclaimed = bytes_reclaimed_.load(std::memory_order_relaxed);
+        stats.skipped_busy = skipped_busy_.load(std::memory_order_relaxed);
+        stats.skipped_recent = skipped_recent_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Enrolled*> entries_;
+
+    std::atomic<uint64_t> passes_{0};
+    std::atomic<uint64_t> vectors_shrunk_{0};
+    std::atomic<uint64_t> bytes_reclaimed_{0};
+    std::atomic<uint64_t> skipped_busy_{0};
+    std::atomic<uint64_t> skipped_recent_{0};
+};
+
+}  // namespace detail
+
+// Вектор, записанный в реестр на всё время жизни. Адрес вектора хранится в реестре,
+// поэтому он не копируется и не перемещается; содержимое можно забрать через Lock()
+template <typename Type>
+class ReclaimableVector final : private detail::Enrolled {
+public:
+    // Доступ к вектору под его мьютексом. При разрушении отмечает время последнего обращения
+    class Access {
+    public:
+        Access(Access&& other) noexcept
+            : lock_(std::move(other.lock_)),
+            owner_(std::exchange(other.owner_, nullptr))
+        {
+        }
+
+        Access(const Access&) = delete;
+        Access& operator=(const Access&) = delete;
+        Access& operator=(Access&&) = delete;
+
+        ~Access() {
+            if (owner_) {
+                owner_->last_use_ = Clock::now();
+            }
+        }
+
+        SimpleVector<Type>& operator*() const noexcept {
+            return owner_->items_;
+        }
+
+        SimpleVector<Type>* operator->() const noexcept {
+            return &owner_->items_;
+        }
+
+    private:
+        friend class ReclaimableVector;
+
+        explicit Access(ReclaimableVector& owner)
+            : lock_(owner.mutex_),
+            owner_(&owner)
+        {
+        }
+
+        // Мьютекс освобождается после записи времени в деструкторе
+        std::unique_lock<std::mutex> lock_;
+        ReclaimableVector* owner_;
+    };
+
+    explicit ReclaimableVector(SimpleVector<Type> items = {})
+        : items_(std::move(items)),
+        last_use_(Clock::now())
+    {
+        detail::Registry::Instance().Enrol(this);
+    }
+
+    ReclaimableVector(const ReclaimableVector&) = delete;
+    ReclaimableVector& operator=(const ReclaimableVector&) = delete;
+
+    ~ReclaimableVector() {
+        detail::Registry::Instance().Withdraw(this);
+    }
+
+    // Блокирует вектор до разрушения возвращённого Access
+    Access Lock() {
+        return Access(*this);
+    }
+
+private:
+    detail::Outcome TryReclaim(Clock::time_point idle_before, uint64_t& bytes) override {
+        std::unique_lock lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return detail::Outcome::Busy;
+        }
+        if (items_.GetCapacity() == items_.GetSize()) {
+            return detail::Outcome::Fitted;
+        }
+        if (last_use_ > idle_before) {
+            return detail::Outcome::Recent;
+        }
+        const uint64_t unused = (items_.GetCapacity() - items_.GetSize()) * sizeof(Type);
+        try {
+            items_.ShrinkToFit();
+        }
+        catch (const std::bad_alloc&) {
+            // буфер точного размера не выделился: вектор остаётся как был
+            return detail::Outcome::Fitted;
+        }
+        bytes = unused;
+        return detail::Outcome::Shrunk;
+    }
+
+    std::mutex mutex_;
+    SimpleVector<Type> items_;
+    Clock::time_point last_use_;
+};
+
+// Уменьшает вместимость до размера у всех свободных векторов, к которым
+// не обращались хотя бы min_idle, и возвращает итоги прохода
+inline ReclaimStats ReclaimIdle(Clock::duration min_idle = Clock::duration::zero()) {
+    return detail::Registry::Instance().ReclaimIdle(min_idle);
+}
+
+// Сумма итогов всех проходов с начала работы программы
+inline ReclaimStats GetReclaimStats() noexcept {
+    return detail::Registry::Instance().GetStats();
+}
+
+inline size_t GetEnrolledCount() {
+    return detail::Registry::Instance().GetSize();
+}
+
+inline const char DEFAULT_CGROUP_DIR[] = "/sys/fs/cgroup";
+constexpr double DEFAULT_PSI_THRESHOLD = 10.0;
+
+// Признаки давления на память в каталоге cgroup v2:
+// - рост счётчиков high, max, oom или oom_kill в memory.events с прошлой проверки;
+// - доля времени "some avg10" в memory.pressure не меньше порога (в процентах).
+// Отсутствующие файлы давлением не считаются, например вне cgroup v2
+class PressureMonitor {
+public:
+    explicit PressureMonitor(std::string cgroup_dir = DEFAULT_CGROUP_DIR,
+                             double psi_threshold = DEFAULT_PSI_THRESHOLD)
+        : cgroup_dir_(std::move(cgroup_dir)),
+        psi_threshold_(psi_threshold)
+    {
+        // события до создания монитора давлением не считаются
+        ReadEvents(last_events_);
+    }
+
+    // Проверяет файлы cgroup и сообщает, есть ли давление
+    bool CheckPressure() {
+        bool pressure = false;
+        uint64_t events = 0;
+        if (ReadEvents(events)) {
+            pressure = events > last_events_;
+            last_events_ = events;
+        }
+        double avg10 = 0.0;
+        if (ReadSomeAvg10(avg10) && avg10 >= psi_threshold_) {
+            pressure = true;
+        }
+        return pressure;
+    }
+
+    const std::string& GetCgroupDir() const noexcept {
+        return cgroup_dir_;
+    }
+
+private:
+    // Сумма счётчиков событий, при которых ядро ограничивало память cgroup
+    bool ReadEvents(uint64_t& total) const {
+        std::ifstream in(cgroup_dir_ + "/memory.events");
+        if (!in) {
+            return false;
+        }
+        total = 0;
+        std::string key;
+        uint64_t value = 0;
+        while (in >> key >> value) {
+            if (key == "high" || key == "max" || key == "oom" || key == "oom_kill") {
+                total += value;
+            }
+        }
+        return true;
+    }
+
+    // Строка вида "some avg10=1.50 avg60=0.20 avg300=0.05 total=12345"
+    bool ReadSomeAvg10(double& avg10) const {
+        std::ifstream in(cgroup_dir_ + "/memory.pressure");
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string kind;
+            std::string field;
+            if (!(fields >> kind >> field) || kind != "some" || field.rfind("avg10=", 0) != 0) {
+                continue;
+            }
+            try {
+                avg10 = std::stod(field.substr(6));
+            }
+            catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    std::string cgroup_dir_;
+    double psi_threshold_;
+    uint64_t last_events_ = 0;
+};
+
+struct ReclaimerOptions {
+    std::string cgroup_dir = DEFAULT_CGROUP_DIR;
+    double psi_threshold = DEFAULT_PSI_THRESHOLD;
+    // Период проверки файлов cgroup
+    std::chrono::milliseconds poll_interval{1000};
+    // Векторы, использованные позже, не уменьшаются
+    std::chrono::milliseconds min_idle{1000};
+};
+
+// Фоновый поток, который проверяет давление раз в poll_interval
+// и при давлении проводит ReclaimIdle(min_idle)
+class MemoryReclaimer {
+public:
+    explicit MemoryReclaimer(ReclaimerOptions options = {})
+        : options_(std::move(options)),
+        monitor_(options_.cgroup_dir, options_.psi_threshold)
+    {
+        worker_ = std::thread([this] {
+            PollLoop();
+        });
+    }
+
+    MemoryReclaimer(const MemoryReclaimer&) = delete;
+    MemoryReclaimer& operator=(const MemoryReclaimer&) = delete;
+
+    ~MemoryReclaimer() {
+        {
+            std::lock_guard guard(mutex_);
+            stopped_ = true;
+        }
+        stop_cv_.notify_one();
+        worker_.join();
+    }
+
+    // Проводит проход сразу, не дожидаясь давления
+    ReclaimStats ReclaimNow() {
+        return ReclaimIdle(options_.min_idle);
+    }
+
+    // Число проверок, обнаруживших давление
+    uint64_t GetPressureCount() const noexcept {
+        return pressure_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void PollLoop() {
+        std::unique_lock lock(mutex_);
+        while (!stop_cv_.wait_for(lock, options_.poll_interval, [this] {
+            return stopped_;
+        })) {
+            lock.unlock();
+            // монитор принадлежит только фоновому потоку
+            if (monitor_.CheckPressure()) {
+                pressure_count_.fetch_add(1, std::memory_order_relaxed);
+                ReclaimIdle(options_.min_idle);
+            }
+            lock.lock();
+        }
+    }
+
+    ReclaimerOptions options_;
+    PressureMonitor monitor_;
+    std::atomic<uint64_t> pressure_count_{0};
+
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stopped_ = false;
+    std::thread worker_;
+};
+
+}  // namespace memory_reclaimer
@@ -0,0 +1,245 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "simple_vector.h"
+
+// Слияние k отсортированных векторов деревом проигравших.
+// Во внутренних узлах дерева хранятся проигравшие в сравнениях, поэтому после
+// выдачи очередного элемента достаточно переиграть путь от его листа к корню:
+// log k сравнений на элемент вместо log k проходов попарного слияния.
+// Результат пишется в заранее выделенный вектор. Слияние устойчиво: из равных
+// элементов первым идёт элемент из прогона с меньшим номером
+namespace merge_detail {
+
+template <typename Type, typename Compare>
+class LoserTree {
+public:
+    // Прогон i — полуинтервал [begins[i], ends[i])
+    LoserTree(SimpleVector<const Type*> begins, SimpleVector<const Type*> ends, Compare compare)
+        : cursors_(std::move(begins)),
+        ends_(std::move(ends)),
+        leaves_(std::bit_ceil(std::max<size_t>(cursors_.GetSize(), 1))),
+        done_(leaves_),
+        losers_(leaves_),
+        compare_(compare)
+    {
+        for (size_t run = 0; run < cursors_.GetSize(); ++run) {
+            remaining_ += static_cast<size_t>(ends_[run] - cursors_[run]);
+            if (cursors_[run] != ends_[run]) {
+                placeholder_ = cursors_[run];
+            }
+        }
+        // недостающие до степени двойки листья — пустые прогоны
+        cursors_.Resize(leaves_);
+        ends_.Resize(leaves_);
+        for (size_t run = 0; run < leaves_; ++run) {
+            if (cursors_[run] == ends_[run]) {
+                MarkDone(run);
+            }
+        }
+        // все прогоны пусты: разыгрывать нечего, а placeholder_ не на что указывать
+        if (remaining_ == 0) {
+            return;
+        }
+        winner_ = Build(1);
+    }
+
+    // Пишет все элементы прогонов в out по возрастанию
+    void MergeInto(Type* out) {
+        for (; remaining_ > 0; --remaining_) {
+            const Type*& cursor = cursors_[winner_];
+            *out++ = *cursor;
+            if (++cursor == ends_[winner_]) {
+                MarkDone(winner_);
+            }
+            Replay();
+        }
+    }
+
+private:
+    // Закончившийся прогон всегда проигрывает. Его курсор указывает на любой
+    // существующий элемент (nullptr, если элементов нет вовсе)
+    void MarkDone(size_t run) noexcept {
+        done_[run] = true;
+        cursors_[run] = placeholder_;
+    }
+
+    // Сообщает, выигрывает ли текущий элемент прогона lhs у элемента прогона rhs.
+    // При равенстве выигрывает прогон с меньшим номером
+    bool Beats(size_t lhs, size_t rhs) const {
+        // закончившиеся прогоны решают исход до разыменования курсоров;
+        // этот переход почти всегда предсказуем, в отличие от сравнения элементов
+        if (done_[lhs] | done_[rhs]) {
+            return !done_[lhs];
+        }
+        const Type& left = *cursors_[lhs];
+        const Type& right = *cursors_[rhs];
+        const bool less = compare_(left, right);
+        const bool not_greater = !compare_(right, left);
+        return less | (not_greater & (lhs < rhs));
+    }
+
+    // Разыгрывает поддерево node и возвращает номер прогона-победителя
+    size_t Build(size_t node) {
+        if (node >= leaves_) {
+            return node - leaves_;
+        }
+        const size_t left = Build(2 * node);
+        const size_t right = Build(2 * node + 1);
+        if (Beats(left, right)) {
+            losers_[node] = right;
+            return left;
+        }
+        losers_[node] = left;
+        return right;
+    }
+
+    // Переигрывает путь от листа победителя к корню. Исход сравнения в каждом узле
+    // непредсказуем, поэтому обмен записан битовой маской, а не переходом
+    void Replay() {
+        size_t winner = winner_;
+        for (size_t node = (winner + leaves_) / 2; node > 0; node /= 2) {
+            const size_t loser = losers_[node];
+            const size_t swap_mask = size_t{0} - static_cast<size_t>(Beats(loser, winner));
+            const size_t difference = (loser ^ winner) & swap_mask;
+            losers_[node] = loser ^ difference;
+            winner ^= difference;
+        }
+        winner_ = winner;
+    }
+
+    SimpleVector<const Type*> cursors_;
+    SimpleVector<const Type*> ends_;
+    size_t leaves_;
+    SimpleVector<bool> done_;
+    // losers_[node] — прогон, проигравший в узле node; узел 0 не используется
+    SimpleVector<size_t> losers_;
+    size_t winner_ = 0;
+    size_t remaining_ = 0;
+    const Type* placeholder_ = nullptr;
+    Compare compare_;
+};
+
+template <typename Type, typename Compare>
+void MergeRange(SimpleVector<const Type*> begins, SimpleVector<const Type*> ends, Type* out, Compare compare) {
+    LoserTree<Type, Compare> tree(std::move(begins), std::move(ends), compare);
+    tree.MergeInto(out);
+}
+
+}  // namespace merge_detail
+
+template <typename Type, typename Compare = std::less<Type>>
+SimpleVector<Type> MergeK(const SimpleVector<SimpleVector<Type>>& runs, Compare compare = Compare()) {
+    size_t total = 0;
+    SimpleVector<const Type*> begins(runs.GetSize());
+    SimpleVector<const Type*> ends(runs.GetSize());
+    for (size_t i = 0; i < runs.GetSize(); ++i) {
+        begins[i] = runs[i].begin();
+        ends[i] = runs[i].end();
+        total += runs[i].GetSize();
+    }
+    SimpleVector<Type> result(total);
+    merge_detail::MergeRange(std::move(begins), std::move(ends), result.begin(), compare);
+    return result;
+}
+
+// То же в threads потоков. Выход делится на части по значениям-разделителям,
+// выбранным из равномерной выборки всех прогонов: граница части в каждом прогоне —
+// первый элемент не меньше разделителя, поэтому части не пересекаются, а их
+// позиции в результате известны заранее. Каждая часть сливается своим деревом
+template <typename Type, typename Compare = std::less<Type>>
+SimpleVector<Type> MergeKParallel(const SimpleVector<SimpleVector<Type>>& runs, size_t threads,
+                                  Compare compare = Compare()) {
+    constexpr size_t samples_per_part = 64;
+    const size_t run_count = runs.GetSize();
+    size_t total = 0;
+    for (const auto& run : runs) {
+        total += run.GetSize();
+    }
+    if (threads <= 1 || total < threads * samples_per_part) {
+        return MergeK(runs, compare);
+    }
+
+    // Выборка: элементы каждого прогона с шагом, пропорциональным его доле в сумме
+    const size_t sample_count = threads * samples_per_part;
+    std::vector<Type> samples;
+    for (const auto& run : runs) {
+        const size_t run_samples = run.GetSize() * sample_count / total;
+        for (size_t i = 0; i < run_samples; ++i) {
+            samples.push_back(run[(2 * i + 1) * run.GetSize() / (2 * run_samples)]);
+        }
+    }
+    if (samples.empty()) {
+        return MergeK(runs, compare);
+    }
+    std::sort(samples.begin(), samples.end(), compare);
+
+    // bounds[part * run_count + run] — начало части part в прогоне run
+    SimpleVector<size_t> bounds((threads + 1) * run_count);
+    SimpleVector<size_t> offsets(threads + 1);
+    for (size_t run = 0; run < run_count; ++run) {
+        bounds[threads * run_count + run] = runs[run].GetSize();
+    }
+    offsets[threads] = total;
+    for (size_t part = 1; part < threads; ++part) {
+        const Type& splitter = samples[part * samples.size() / threads];
+        size_t offset = 0;
+        for (size_t run = 0; run < run_count; ++run) {
+            const size_t position = static_cast<size_t>(
+                std::lower_bound(runs[run].begin(), runs[run].end(), splitter, compare) - runs[run].begin());
+            // разделители не убывают, поэтому части не пересекаются
+            bounds[part * run_count + run] = std::max(position, bounds[(part - 1) * run_count + run]);
+            offset += bounds[part * run_count + run];
+        }
+        offsets[part] = offset;
+    }
+
+    SimpleVector<Type> result(total);
+    auto merge_part = [&](size_t part) {
+        SimpleVector<const Type*> begins(run_count);
+        SimpleVector<const Type*> ends(run_count);
+        for (size_t run = 0; run < run_count; ++run) {
+            begins[run] = runs[run].begin() + bounds[part * run_count + run];
+            ends[run] = runs[run].begin() + bounds[(part + 1) * run_count + run];
+        }
+        merge_detail::MergeRange(std::move(begins), std::move(ends), result.begin() + offsets[part], compare);
+    };
+    std::vector<std::exception_ptr> errors(threads);
+    auto run_part = [&](size_t part) {
+        try {
+            merge_part(part);
+        }
+        catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t part = 1; part < threads; ++part) {
+        try {
+            workers.emplace_back(run_part, part);
+        }
+        catch (...) {
+            // поток не создан: часть сливается в текущем потоке
+            run_part(part);
+        }
+    }
+    run_part(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return result;
+}
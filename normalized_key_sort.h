@@ -0,0 +1,105 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "simple_vector.h"
+
+// Сортировка вектора векторов целых чисел по нормализованным ключам.
+// Из первых элементов каждого вектора собирается 64-битный ключ, сравнение которого
+// как беззнакового числа совпадает с лексикографическим сравнением префиксов:
+// у знаковых чисел инвертируется старший бит, недостающие элементы дополняются нулями.
+// Пары (ключ, индекс) лежат в одном непрерывном массиве и сортируются поразрядно,
+// а векторы с одинаковыми ключами досортировываются полным сравнением.
+// Сортировка устойчива
+namespace normalized_key_detail {
+
+struct KeyedIndex {
+    uint64_t key;
+    size_t index;
+};
+
+template <typename Type>
+uint64_t MakeKey(const SimpleVector<Type>& items) noexcept {
+    using Unsigned = std::make_unsigned_t<Type>;
+    constexpr size_t bits = sizeof(Type) * 8;
+    constexpr size_t key_elements = 64 / bits;
+    constexpr Unsigned sign_flip = std::is_signed_v<Type> ? Unsigned{1} << (bits - 1) : Unsigned{0};
+    uint64_t key = 0;
+    const size_t count = std::min(items.GetSize(), key_elements);
+    for (size_t i = 0; i < count; ++i) {
+        const Unsigned normalized = static_cast<Unsigned>(static_cast<Unsigned>(items[i]) ^ sign_flip);
+        key |= static_cast<uint64_t>(normalized) << (64 - bits * (i + 1));
+    }
+    return key;
+}
+
+// Поразрядная сортировка по байтам ключа от младшего к старшему.
+// Байты, одинаковые у всех ключей, пропускаются
+inline void RadixSort(SimpleVector<KeyedIndex>& items) {
+    constexpr size_t digits = sizeof(uint64_t);
+    size_t counts[digits][256] = {};
+    for (const KeyedIndex& item : items) {
+        for (size_t digit = 0; digit < digits; ++digit) {
+            ++counts[digit][item.key >> (8 * digit) & 0xFF];
+        }
+    }
+    SimpleVector<KeyedIndex> buffer(items.GetSize());
+    for (size_t digit = 0; digit < digits; ++digit) {
+        size_t* const count = counts[digit];
+        if (count[items[0].key >> (8 * digit) & 0xFF] == items.GetSize()) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t value = 0; value < 256; ++value) {
+            offset += std::exchange(count[value], offset);
+        }
+        for (const KeyedIndex& item : items) {
+            buffer[count[item.key >> (8 * digit) & 0xFF]++] = item;
+        }
+        items.swap(buffer);
+    }
+}
+
+}  // namespace normalized_key_detail
+
+template <typename Type>
+void SortByNormalizedKey(SimpleVector<SimpleVector<Type>>& vectors) {
+    static_assert(std::is_integral_v<Type> && !std::is_same_v<Type, bool> && sizeof(Type) <= sizeof(uint64_t),
+                  "normalized keys are built for integers up to 64 bits");
+    using normalized_key_detail::KeyedIndex;
+    const size_t size = vectors.GetSize();
+    if (size < 2) {
+        return;
+    }
+    SimpleVector<KeyedIndex> keys(size);
+    for (size_t i = 0; i < size; ++i) {
+        keys[i] = KeyedIndex{normalized_key_detail::MakeKey(vectors[i]), i};
+    }
+    normalized_key_detail::RadixSort(keys);
+
+    // одинаковые ключи означают лишь равные префиксы
+    for (size_t begin = 0; begin < size;) {
+        size_t end = begin + 1;
+        while (end < size && keys[end].key == keys[begin].key) {
+            ++end;
+        }
+        if (end - begin > 1) {
+            std::stable_sort(keys.begin() + begin, keys.begin() + end,
+                             [&vectors](const KeyedIndex& lhs, const KeyedIndex& rhs) {
+                                 return vectors[lhs.index] < vectors[rhs.index];
+                             });
+        }
+        begin = end;
+    }
+
+    // перемещение вектора переносит только указатель на его буфер
+    SimpleVector<SimpleVector<Type>> sorted(size);
+    for (size_t i = 0; i < size; ++i) {
+        sorted[i] = std::move(vectors[keys[i].index]);
+    }
+    vectors.swap(sorted);
+}
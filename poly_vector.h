@@ -0,0 +1,386 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "array_ptr.h"
+#include "simple_vector.h"
+
+// Тип можно перемещать в новый буфер копированием байтов, не вызывая конструктор
+// перемещения и деструктор. Специализируется пользователем для своих типов.
+// Тип с виртуальными функциями никогда не бывает тривиально копируемым, поэтому
+// для полиморфных объектов перенос одним memcpy включается только специализацией:
+//     template <>
+//     inline constexpr bool IS_TRIVIALLY_RELOCATABLE<MyShape> = true;
+// Без неё каждый объект переносится конструктором перемещения
+template <typename Type>
+inline constexpr bool IS_TRIVIALLY_RELOCATABLE = std::is_trivially_copyable_v<Type>;
+
+// Вектор объектов разных типов, производных от Base.
+// Объекты хранятся подряд в одном буфере, каждый со своим выравниванием, а рядом
+// с ним лежит таблица записей: смещение объекта, смещение его подобъекта Base
+// и операции перемещения и разрушения. Обход не выделяет памяти на элемент
+// и не переходит по указателям в кучу. При росте буфер увеличивается вдвое,
+// объекты переносятся конструктором перемещения, а если все они тривиально
+// перемещаемы (IS_TRIVIALLY_RELOCATABLE), то одним memcpy
+template <typename Base>
+class PolyVector {
+    // Ячейка буфера с максимальным фундаментальным выравниванием
+    struct alignas(std::max_align_t) Cell {
+        std::byte bytes[alignof(std::max_align_t)];
+    };
+
+    // Операции, общие для всех объектов одного типа
+    struct ElementOps {
+        // Создаёт в to объект из объекта в from. Объект в from разрушается отдельно
+        void (*relocate)(std::byte* from, std::byte* to);
+        void (*destroy)(std::byte* object) noexcept;
+        bool trivially_relocatable;
+    };
+
+    struct Entry {
+        size_t object_offset = 0;
+        size_t base_offset = 0;
+        const ElementOps* ops = nullptr;
+    };
+
+    template <bool IsConst>
+    class BasicIterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Base;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const Base*, Base*>;
+        using reference = std::conditional_t<IsConst, const Base&, Base&>;
+
+        BasicIterator() = default;
+
+        reference operator*() const noexcept {
+            return *std::launder(reinterpret_cast<pointer>(data_ + entry_->base_offset));
+        }
+
+        pointer operator->() const noexcept {
+            return &**this;
+        }
+
+        reference operator[](difference_type offset) const noexcept {
+            return *(*this + offset);
+        }
+
+        BasicIterator& operator++() noexcept {
+            ++entry_;
+            return *this;
+        }
+
+        BasicIterator operator++(int) noexcept {
+            BasicIterator result = *this;
+            ++entry_;
+            return result;
+        }
+
+        BasicIterator& operator--() noexcept {
+            --entry_;
+            return *this;
+        }
+
+        BasicIterator operator--(int) noexcept {
+            BasicIterator result = *this;
+            --entry_;
+            return result;
+        }
+
+        BasicIterator& operator+=(difference_type offset) noexcept {
+            entry_ += offset;
+            return *this;
+        }
+
+        BasicIterator& operator-=(difference_type offset) noexcept {
+            entry_ -= offset;
+            return *this;
+        }
+
+        friend BasicIterator operator+(BasicIterator it, difference_type offset) noexcept {
+            return it += offset;
+        }
+
+        friend BasicIterator operator+(difference_type offset, BasicIterator it) noexcept {
+            return it += offset;
+        }
+
+        friend BasicIterator operator-(BasicIterator it, difference_type offset) noexcept {
+            return it -= offset;
+        }
+
+        friend difference_type operator-(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.entry_ - rhs.entry_;
+        }
+
+        friend bool operator==(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.entry_ == rhs.entry_;
+        }
+
+        friend auto operator<=>(const BasicIterator& lhs, const BasicIterator& rhs) noexcept {
+            return lhs.entry_ <=> rhs.entry_;
+        }
+
+    private:
+        friend class PolyVector;
+
+        using Byte = std::conditional_t<IsConst, const std::byte, std::byte>;
+
+        BasicIterator(Byte* data, const Entry* entry) noexcept
+            : data_(data),
+            entry_(entry)
+        {
+        }
+
+        Byte* data_ = nullptr;
+        const Entry* entry_ = nullptr;
+    };
+
+public:
+    using Iterator = BasicIterator<false>;
+    using ConstIterator = BasicIterator<true>;
+
+    PolyVector() noexcept = default;
+
+    // Резервирует место под count записей и bytes байт объектов
+    PolyVector(size_t count, size_t bytes) {
+        Reserve(count, bytes);
+    }
+
+    PolyVector(const PolyVector&) = delete;
+    PolyVector& operator=(const PolyVector&) = delete;
+
+    PolyVector(PolyVector&& other) noexcept {
+        swap(other);
+    }
+
+    PolyVector& operator=(PolyVector&& other) noexcept {
+        if (this != &other) {
+            PolyVector moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    ~PolyVector() {
+        Clear();
+    }
+
+    size_t GetSize() const noexcept {
+        return entries_.GetSize();
+    }
+
+    bool IsEmpty() const noexcept {
+        return entries_.IsEmpty();
+    }
+
+    // Занятые объектами байты буфера с учётом выравнивания
+    size_t GetBytesUsed() const noexcept {
+        return bytes_used_;
+    }
+
+    size_t GetBytesCapacity() const noexcept {
+        return cell_capacity_ * sizeof(Cell);
+    }
+
+    Base& operator[](size_t index) noexcept {
+        return begin()[index];
+    }
+
+    const Base& operator[](size_t index) const noexcept {
+        return begin()[index];
+    }
+
+    // Возвращает ссылку на элемент с индексом index.
+    // Выбрасывает std::out_of_range, если index >= size
+    Base& At(size_t index) {
+        if (index >= GetSize()) {
+            throw std::out_of_range("index >= size");
+        }
+        return (*this)[index];
+    }
+
+    const Base& At(size_t index) const {
+        if (index >= GetSize()) {
+            throw std::out_of_range("index >= size");
+        }
+        return (*this)[index];
+    }
+
+    // Создаёт объект Derived в конце вектора и возвращает ссылку на него.
+    // При исключении вектор остаётся прежним
+    template <typename Derived, typename... Args>
+    Derived& EmplaceBack(Args&&... args) {
+        static_assert(std::is_base_of_v<Base, Derived>, "Derived must be derived from Base");
+        static_assert(alignof(Derived) <= alignof(Cell), "over-aligned types are not supported");
+        static_assert(std::is_move_constructible_v<Derived> || IS_TRIVIALLY_RELOCATABLE<Derived>,
+                      "Derived must be movable to grow the buffer");
+
+        const size_t object_offset = AlignUp(bytes_used_, alignof(Derived));
+        const size_t new_bytes_used = object_offset + sizeof(Derived);
+        if (new_bytes_used > GetBytesCapacity()) {
+            Reallocate(std::max(new_bytes_used, 2 * GetBytesCapacity()));
+        }
+        // место под запись выделяется до создания объекта, чтобы после него ничто не выбрасывало исключений
+        if (entries_.GetSize() == entries_.GetCapacity()) {
+            entries_.Reserve(std::max<size_t>(2 * entries_.GetCapacity(), 1));
+        }
+
+        std::byte* const place = GetData() + object_offset;
+        Derived* const object = ::new (static_cast<void*>(place)) Derived(std::forward<Args>(args)...);
+        const Base* const base = object;
+        const size_t base_offset =
+            object_offset + static_cast<size_t>(reinterpret_cast<const std::byte*>(base) - place);
+        entries_.PushBack(Entry{object_offset, base_offset, &OPS<Derived>});
+        bytes_used_ = new_bytes_used;
+        if constexpr (!IS_TRIVIALLY_RELOCATABLE<Derived>) {
+            ++non_trivial_count_;
+        }
+        return *object;
+    }
+
+    // Разрушает последний объект. Вектор не должен быть пустым
+    void PopBack() noexcept {
+        const Entry& last = entries_[entries_.GetSize() - 1];
+        DestroyEntry(last);
+        if (!last.ops->trivially_relocatable) {
+            --non_trivial_count_;
+        }
+        bytes_used_ = last.object_offset;
+        entries_.PopBack();
+    }
+
+    // Разрушает все объекты, сохраняя буфер
+    void Clear() noexcept {
+        for (const Entry& entry : entries_) {
+            DestroyEntry(entry);
+        }
+        entries_.Clear();
+        bytes_used_ = 0;
+        non_trivial_count_ = 0;
+    }
+
+    // Резервирует место под count записей и bytes байт объектов
+    void Reserve(size_t count, size_t bytes) {
+        entries_.Reserve(count);
+        if (bytes > GetBytesCapacity()) {
+            Reallocate(bytes);
+        }
+    }
+
+    void swap(PolyVector& other) noexcept {
+        buffer_.swap(other.buffer_);
+        std::swap(cell_capacity_, other.cell_capacity_);
+        std::swap(bytes_used_, other.bytes_used_);
+        std::swap(non_trivial_count_, other.non_trivial_count_);
+        entries_.swap(other.entries_);
+    }
+
+    Iterator begin() noexcept {
+        return Iterator(GetData(), entries_.begin());
+    }
+
+    Iterator end() noexcept {
+        return Iterator(GetData(), entries_.end());
+    }
+
+    ConstIterator begin() const noexcept {
+        return ConstIterator(GetData(), entries_.begin());
+    }
+
+    ConstIterator end() const noexcept {
+        return ConstIterator(GetData(), entries_.end());
+    }
+
+    ConstIterator cbegin() const noexcept {
+        return begin();
+    }
+
+    ConstIterator cend() const noexcept {
+        return end();
+    }
+
+private:
+    template <typename Derived>
+    static void Relocate(std::byte* from, std::byte* to) {
+        Derived* const source = std::launder(reinterpret_cast<Derived*>(from));
+        ::new (static_cast<void*>(to)) Derived(std::move_if_noexcept(*source));
+    }
+
+    template <typename Derived>
+    static void Destroy(std::byte* object) noexcept {
+        std::launder(reinterpret_cast<Derived*>(object))->~Derived();
+    }
+
+    template <typename Derived>
+    static constexpr ElementOps OPS{&Relocate<Derived>, &Destroy<Derived>, IS_TRIVIALLY_RELOCATABLE<Derived>};
+
+    static size_t AlignUp(size_t offset, size_t alignment) noexcept {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    std::byte* GetData() noexcept {
+        return reinterpret_cast<std::byte*>(buffer_.Get());
+    }
+
+    const std::byte* GetData() const noexcept {
+        return reinterpret_cast<const std::byte*>(buffer_.Get());
+    }
+
+    void DestroyEntry(const Entry& entry) noexcept {
+        entry.ops->destroy(GetData() + entry.object_offset);
+    }
+
+    // Переносит объекты в новый буфер не меньше bytes байт.
+    // Если перенос объекта выбрасывает исключение, уже перенесённые копии
+    // разрушаются, а прежний буфер остаётся нетронутым
+    void Reallocate(size_t bytes) {
+        const size_t cell_capacity = (bytes + sizeof(Cell) - 1) / sizeof(Cell);
+        // ячейки не инициализируются: в них будут созданы объекты
+        ArrayPtr<Cell> new_buffer = ArrayPtr<Cell>::Uninitialized(cell_capacity);
+        std::byte* const new_data = reinterpret_cast<std::byte*>(new_buffer.Get());
+        std::byte* const old_data = GetData();
+
+        if (non_trivial_count_ == 0) {
+            if (bytes_used_ > 0) {
+                std::memcpy(new_data, old_data, bytes_used_);
+            }
+        }
+        else {
+            size_t relocated = 0;
+            try {
+                for (; relocated < entries_.GetSize(); ++relocated) {
+                    const Entry& entry = entries_[relocated];
+                    entry.ops->relocate(old_data + entry.object_offset, new_data + entry.object_offset);
+                }
+            }
+            catch (...) {
+                for (size_t i = 0; i < relocated; ++i) {
+                    entries_[i].ops->destroy(new_data + entries_[i].object_offset);
+                }
+                throw;
+            }
+            for (const Entry& entry : entries_) {
+                DestroyEntry(entry);
+            }
+        }
+        buffer_.swap(new_buffer);
+        cell_capacity_ = cell_capacity;
+    }
+
+    ArrayPtr<Cell> buffer_;
+    size_t cell_capacity_ = 0;
+    size_t bytes_used_ = 0;
+    // Число объектов, которые нельзя переносить копированием байтов
+    size_t non_trivial_count_ = 0;
+    SimpleVector<Entry> entries_;
+};
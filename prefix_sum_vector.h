@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+#include "simple_vector.h"
+
+// Вектор с быстрыми префиксными суммами.
+// Рядом со значениями хранится дерево Фенвика: изменение элемента, сумма префикса
+// и поиск позиции по накопленной сумме выполняются за O(log n), построение по
+// готовому вектору — за O(n). Поиск спускается по дереву от старшего бита индекса,
+// поэтому читает по одному элементу на уровень без повторных проходов от корня
+template <typename Type>
+class PrefixSumVector {
+public:
+    PrefixSumVector() = default;
+
+    // Строит дерево по values за O(n)
+    explicit PrefixSumVector(const SimpleVector<Type>& values)
+        : values_(values),
+        tree_(values.GetSize() + 1)
+    {
+        const size_t size = values_.GetSize();
+        for (size_t i = 1; i <= size; ++i) {
+            tree_[i] += values_[i - 1];
+            const size_t parent = i + LowBit(i);
+            if (parent <= size) {
+                tree_[parent] += tree_[i];
+            }
+        }
+    }
+
+    size_t GetSize() const noexcept {
+        return values_.GetSize();
+    }
+
+    bool IsEmpty() const noexcept {
+        return values_.IsEmpty();
+    }
+
+    const Type& operator[](size_t index) const noexcept {
+        assert(index < GetSize());
+        return values_[index];
+    }
+
+    // Выбрасывает std::out_of_range, если index >= size
+    const Type& At(size_t index) const {
+        return values_.At(index);
+    }
+
+    const SimpleVector<Type>& GetValues() const noexcept {
+        return values_;
+    }
+
+    // Прибавляет delta к элементу index
+    void Add(size_t index, const Type& delta) noexcept {
+        assert(index < GetSize());
+        values_[index] += delta;
+        for (size_t i = index + 1; i < tree_.GetSize(); i += LowBit(i)) {
+            tree_[i] += delta;
+        }
+    }
+
+    void Set(size_t index, const Type& value) noexcept {
+        assert(index < GetSize());
+        Add(index, value - values_[index]);
+    }
+
+    // Сумма первых count элементов
+    Type PrefixSum(size_t count) const noexcept {
+        assert(count <= GetSize());
+        Type sum{};
+        for (size_t i = count; i > 0; i -= LowBit(i)) {
+            sum += tree_[i];
+        }
+        return sum;
+    }
+
+    // Сумма элементов с индексами [begin, end)
+    Type RangeSum(size_t begin, size_t end) const noexcept {
+        assert(begin <= end);
+        return PrefixSum(end) - PrefixSum(begin);
+    }
+
+    // Наименьший индекс i, для которого PrefixSum(i + 1) >= target, или GetSize(), если такого нет.
+    // Все элементы должны быть неотрицательны
+    size_t LowerBound(Type target) const noexcept {
+        size_t position = 0;
+        for (size_t step = std::bit_floor(GetSize()); step > 0; step >>= 1) {
+            const size_t next = position + step;
+            if (next <= GetSize() && tree_[next] < target) {
+                position = next;
+                target -= tree_[next];
+            }
+        }
+        return position;
+    }
+
+    // Добавляет элемент в конец за O(log n)
+    void PushBack(const Type& value) {
+        if (tree_.IsEmpty()) {
+            tree_.PushBack(Type{});
+        }
+        const size_t i = tree_.GetSize();
+        // узел i покрывает элементы (i - LowBit(i), i]
+        const Type node = value + PrefixSum(i - 1) - PrefixSum(i - LowBit(i));
+        values_.PushBack(value);
+        try {
+            tree_.PushBack(node);
+        }
+        catch (...) {
+            values_.PopBack();
+            throw;
+        }
+    }
+
+    void PopBack() noexcept {
+        assert(!IsEmpty());
+        values_.PopBack();
+        tree_.PopBack();
+    }
+
+    void Clear() noexcept {
+        values_.Clear();
+        tree_.Clear();
+    }
+
+    void Reserve(size_t capacity) {
+        values_.Reserve(capacity);
+        tree_.Reserve(capacity + 1);
+    }
+
+private:
+    static size_t LowBit(size_t i) noexcept {
+        return i & (~i + 1);
+    }
+
+    SimpleVector<Type> values_;
+    // tree_[i] хранит сумму элементов (i - LowBit(i), i], tree_[0] не используется
+    SimpleVector<Type> tree_;
+};
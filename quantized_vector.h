@@ -0,0 +1,369 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Компактное хранение float: половинная точность IEEE (Float16), bfloat16 (BFloat16)
+// или int8 с масштабом на блок из 32 значений (Int8). Значения округляются к ближайшему
+// при записи и восстанавливаются при чтении прямо в регистры AVX2 (F16C для Float16,
+// если доступен), поэтому скалярные произведения и выгрузка не создают промежуточных
+// массивов float. Без AVX2 используются скалярные ядра с тем же результатом восстановления.
+// Погрешность восстановления x:
+// - Float16: не больше |x| * 2^-11 в диапазоне нормальных чисел и 2^-25 около нуля;
+//   числа больше 65504 по модулю становятся бесконечностями;
+// - BFloat16: не больше |x| * 2^-8, диапазон как у float;
+// - Int8: не больше половины шага max|x| / 127 блока, в котором лежит x
+enum class Quantization {
+    Float16,
+    BFloat16,
+    Int8,
+};
+
+namespace quantized_detail {
+
+constexpr size_t INT8_BLOCK_SIZE = 32;
+constexpr int INT8_MAX_CODE = 127;
+
+inline uint16_t FloatToHalf(float value) noexcept {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+    if (magnitude > 0x7f800000) {
+        // NaN остаётся тихим NaN
+        return sign | 0x7e00;
+    }
+    if (magnitude >= 0x477ff000) {
+        // не меньше 65520: округляется к бесконечности
+        return sign | 0x7c00;
+    }
+    if (magnitude < 0x38800000) {
+        // денормализованное число половинной точности: умножение на 2^24 точное
+        const float scaled = std::bit_cast<float>(magnitude) * 16777216.0f;
+        return sign | static_cast<uint16_t>(std::nearbyint(scaled));
+    }
+    // округление к ближайшему чётному при отбрасывании 13 младших бит мантиссы
+    magnitude += 0xfff + ((magnitude >> 13) & 1);
+    return sign | static_cast<uint16_t>((magnitude - 0x38000000) >> 13);
+}
+
+// Экспонента сдвигается умножением на 2^112, что точно и для денормализованных чисел
+inline float HalfToFloat(uint16_t half) noexcept {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t shifted = static_cast<uint32_t>(half & 0x7fff) << 13;
+    uint32_t magnitude = std::bit_cast<uint32_t>(std::bit_cast<float>(shifted) * 0x1p112f);
+    if ((half & 0x7c00) == 0x7c00) {
+        magnitude = 0x7f800000 | shifted;
+    }
+    return std::bit_cast<float>(sign | magnitude);
+}
+
+inline uint16_t FloatToBFloat16(float value) noexcept {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40);
+    }
+    return static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
+
+inline float BFloat16ToFloat(uint16_t value) noexcept {
+    return std::bit_cast<float>(static_cast<uint32_t>(value) << 16);
+}
+
+template <Quantization Format>
+using Code = std::conditional_t<Format == Quantization::Int8, int8_t, uint16_t>;
+
+#if defined(__AVX2__)
+
+inline __m256 MulAdd(__m256 a, __m256 b, __m256 c) noexcept {
+#if defined(__FMA__)
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+inline float HorizontalSum(__m256 value) noexcept {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+inline __m256 LoadHalf8(const uint16_t* codes) noexcept {
+    const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes));
+#if defined(__F16C__)
+    return _mm256_cvtph_ps(halves);
+#else
+    const __m256i wide = _mm256_cvtepu16_epi32(halves);
+    const __m256i shifted = _mm256_slli_epi32(_mm256_and_si256(wide, _mm256_set1_epi32(0x7fff)), 13);
+    const __m256i sign = _mm256_slli_epi32(_mm256_and_si256(wide, _mm256_set1_epi32(0x8000)), 16);
+    __m256i magnitude = _mm256_castps_si256(_mm256_mul_ps(_mm256_castsi256_ps(shifted), _mm256_set1_ps(0x1p112f)));
+    const __m256i special = _mm256_cmpeq_epi32(_mm256_and_si256(wide, _mm256_set1_epi32(0x7c00)),
+                                               _mm256_set1_epi32(0x7c00));
+    magnitude = _mm256_blendv_epi8(magnitude, _mm256_or_si256(shifted, _mm256_set1_epi32(0x7f800000)), special);
+    return _mm256_castsi256_ps(_mm256_or_si256(sign, magnitude));
+#endif
+}
+
+inline __m256 LoadBFloat8(const uint16_t* codes) noexcept {
+    const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(values), 16));
+}
+
+inline __m256 LoadInt8(const int8_t* codes, float scale) noexcept {
+    const __m128i values = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(values)), _mm256_set1_ps(scale));
+}
+
+#endif
+
+}  // namespace quantized_detail
+
+template <Quantization Format>
+class QuantizedVector {
+public:
+    using Code = quantized_detail::Code<Format>;
+
+    QuantizedVector() = default;
+
+    // Квантует size чисел. Для Int8 выбрасывает std::invalid_argument,
+    // если среди них есть бесконечность или NaN: у блока не было бы конечного масштаба
+    QuantizedVector(const float* data, size_t size)
+        : size_(size),
+        codes_(size)
+    {
+        if constexpr (Format == Quantization::Int8) {
+            EncodeInt8(data);
+        }
+        else {
+            EncodeHalves(data);
+        }
+    }
+
+    explicit QuantizedVector(const SimpleVector<float>& items)
+        : QuantizedVector(items.begin(), items.GetSize())
+    {
+    }
+
+    size_t GetSize() const noexcept {
+        return size_;
+    }
+
+    bool IsEmpty() const noexcept {
+        return size_ == 0;
+    }
+
+    // Память кодов и масштабов
+    size_t GetSizeInBytes() const noexcept {
+        return codes_.GetSize() * sizeof(Code) + scales_.GetSize() * sizeof(float);
+    }
+
+    float operator[](size_t index) const noexcept {
+        return DecodeOne(index);
+    }
+
+    float At(size_t index) const {
+        if (index >= size_) {
+            throw std::out_of_range("index >= size");
+        }
+        return DecodeOne(index);
+    }
+
+    // Восстанавливает значения [begin, begin + count) в out.
+    // Выбрасывает std::out_of_range, если диапазон выходит за размер
+    void Decode(size_t begin, size_t count, float* out) const {
+        CheckRange(begin, count);
+        size_t i = begin;
+        const size_t end = begin + count;
+#if defined(__AVX2__)
+        for (; i < end && i % 8 != 0; ++i) {
+            *out++ = DecodeOne(i);
+        }
+        for (; i + 8 <= end; i += 8, out += 8) {
+            _mm256_storeu_ps(out, Load8(i));
+        }
+#endif
+        DecodeTail(i, end, out);
+    }
+
+    SimpleVector<float> Decode() const {
+        SimpleVector<float> result(size_);
+        Decode(0, size_, result.begin());
+        return result;
+    }
+
+    // Скалярное произведение значений [begin, begin + count) на query[0, count).
+    // Выбрасывает std::out_of_range, если диапазон выходит за размер
+    float Dot(size_t begin, const float* query, size_t count) const {
+        CheckRange(begin, count);
+        float result = 0.0f;
+        size_t i = begin;
+        const size_t end = begin + count;
+#if defined(__AVX2__)
+        // начало выравнивается на 8, чтобы восьмёрка Int8 не пересекала границу блока
+        for (; i < end && i % 8 != 0; ++i) {
+            result += DecodeOne(i) * *query++;
+        }
+        __m256 first = _mm256_setzero_ps();
+        __m256 second = _mm256_setzero_ps();
+        for (; i + 16 <= end; i += 16, query += 16) {
+            first = quantized_detail::MulAdd(Load8(i), _mm256_loadu_ps(query), first);
+            second = quantized_detail::MulAdd(Load8(i + 8), _mm256_loadu_ps(query + 8), second);
+        }
+        if (i + 8 <= end) {
+            first = quantized_detail::MulAdd(Load8(i), _mm256_loadu_ps(query), first);
+            i += 8;
+            query += 8;
+        }
+        result += quantized_detail::HorizontalSum(_mm256_add_ps(first, second));
+#endif
+        return result + DotTail(i, end, query);
+    }
+
+    float Dot(const SimpleVector<float>& query) const {
+        if (query.GetSize() != size_) {
+            throw std::invalid_argument("query size differs from vector size");
+        }
+        return Dot(0, query.begin(), size_);
+    }
+
+private:
+    void CheckRange(size_t begin, size_t count) const {
+        if (begin > size_ || count > size_ - begin) {
+            throw std::out_of_range("range exceeds size");
+        }
+    }
+
+    void EncodeHalves(const float* data) noexcept {
+        size_t i = 0;
+#if defined(__F16C__)
+        if constexpr (Format == Quantization::Float16) {
+            for (; i + 8 <= size_; i += 8) {
+                const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(data + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(codes_.begin() + i), halves);
+            }
+        }
+#endif
+        Code* const codes = codes_.begin();
+        for (; i < size_; ++i) {
+            if constexpr (Format == Quantization::Float16) {
+                codes[i] = quantized_detail::FloatToHalf(data[i]);
+            }
+            else {
+                codes[i] = quantized_detail::FloatToBFloat16(data[i]);
+            }
+        }
+    }
+
+    void EncodeInt8(const float* data) {
+        using namespace quantized_detail;
+        constexpr float MAX_CODE = INT8_MAX_CODE;
+        scales_ = SimpleVector<float>((size_ + INT8_BLOCK_SIZE - 1) / INT8_BLOCK_SIZE);
+        for (size_t block = 0; block < scales_.GetSize(); ++block) {
+            const size_t begin = block * INT8_BLOCK_SIZE;
+            const size_t end = std::min(begin + INT8_BLOCK_SIZE, size_);
+            float max_magnitude = 0.0f;
+            for (size_t i = begin; i < end; ++i) {
+                if (!std::isfinite(data[i])) {
+                    throw std::invalid_argument("Int8 quantization requires finite values");
+                }
+                max_magnitude = std::max(max_magnitude, std::fabs(data[i]));
+            }
+            const float scale = max_magnitude / MAX_CODE;
+            scales_[block] = scale;
+            if (scale == 0.0f) {
+                continue;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                const float code = std::nearbyint(data[i] / scale);
+                codes_[i] = static_cast<int8_t>(std::clamp(code, -MAX_CODE, MAX_CODE));
+            }
+        }
+    }
+
+    float DecodeOne(size_t index) const noexcept {
+        const Code code = codes_.begin()[index];
+        if constexpr (Format == Quantization::Float16) {
+            return quantized_detail::HalfToFloat(code);
+        }
+        else if constexpr (Format == Quantization::BFloat16) {
+            return quantized_detail::BFloat16ToFloat(code);
+        }
+        else {
+            return code * scales_.begin()[index / quantized_detail::INT8_BLOCK_SIZE];
+        }
+    }
+
+    // Скалярные ядра: для Int8 масштаб читается один раз на блок
+    void DecodeTail(size_t i, size_t end, float* out) const noexcept {
+        const Code* const codes = codes_.begin();
+        if constexpr (Format == Quantization::Int8) {
+            while (i < end) {
+                const size_t block = i / quantized_detail::INT8_BLOCK_SIZE;
+                const size_t block_end = std::min(end, (block + 1) * quantized_detail::INT8_BLOCK_SIZE);
+                const float scale = scales_.begin()[block];
+                for (; i < block_end; ++i) {
+                    *out++ = codes[i] * scale;
+                }
+            }
+        }
+        else {
+            for (; i < end; ++i) {
+                *out++ = DecodeOne(i);
+            }
+        }
+    }
+
+    float DotTail(size_t i, size_t end, const float* query) const noexcept {
+        const Code* const codes = codes_.begin();
+        float result = 0.0f;
+        if constexpr (Format == Quantization::Int8) {
+            while (i < end) {
+                const size_t block = i / quantized_detail::INT8_BLOCK_SIZE;
+                const size_t block_end = std::min(end, (block + 1) * quantized_detail::INT8_BLOCK_SIZE);
+                float block_sum = 0.0f;
+                for (; i < block_end; ++i) {
+                    block_sum += codes[i] * *query++;
+                }
+                result += block_sum * scales_.begin()[block];
+            }
+        }
+        else {
+            for (; i < end; ++i) {
+                result += DecodeOne(i) * *query++;
+            }
+        }
+        return result;
+    }
+
+#if defined(__AVX2__)
+    // Восемь значений начиная с index; для Int8 index кратен 8
+    __m256 Load8(size_t index) const noexcept {
+        if constexpr (Format == Quantization::Float16) {
+            return quantized_detail::LoadHalf8(codes_.begin() + index);
+        }
+        else if constexpr (Format == Quantization::BFloat16) {
+            return quantized_detail::LoadBFloat8(codes_.begin() + index);
+        }
+        else {
+            return quantized_detail::LoadInt8(codes_.begin() + index,
+                                              scales_[index / quantized_detail::INT8_BLOCK_SIZE]);
+        }
+    }
+#endif
+
+    size_t size_ = 0;
+    SimpleVector<Code> codes_;
+    // Масштаб блока Int8; для других форматов пуст
+    SimpleVector<float> scales_;
+};
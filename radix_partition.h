@@ -0,0 +1,168 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "simple_vector.h"
+
+// Поразрядное разбиение элементов по корзинам.
+// Корзина элемента — младшие radix_bits бит ключа key(item). Сначала гистограмма
+// по всем корзинам: каждая корзина создаётся сразу нужного размера, а смещения
+// промежуточных проходов получаются суммированием её групп без повторного подсчёта.
+// Элементы раскладываются через программные буферы записи: в каждой корзине копится
+// по кэш-линии элементов в выровненном по 64 байтам буфере, которая затем копируется
+// в корзину целиком, так что запись идёт полными линиями, а не одиночными элементами
+// по сотням адресов. Так раскладываются тривиально копируемые типы, размер которых
+// делит 64; остальные пишутся в корзины напрямую.
+// Если корзин больше, чем 2^pass_bits, разбиение идёт в несколько проходов
+// от старших бит к младшим, и на каждом проходе открыто не больше 2^pass_bits корзин.
+// Порядок элементов внутри корзины совпадает с порядком во входном векторе
+namespace radix_partition_detail {
+
+constexpr size_t CACHE_LINE = 64;
+
+template <typename Type>
+constexpr size_t LINE_ITEMS = std::max<size_t>(CACHE_LINE / sizeof(Type), 1);
+
+// Программные буферы записи нужны, только если линия буфера целиком ложится
+// на линию корзины: тип копируется байтами, а кэш-линия делится на элементы без остатка
+template <typename Type>
+constexpr bool USE_WRITE_COMBINING = std::is_trivially_copyable_v<Type> && CACHE_LINE % sizeof(Type) == 0;
+
+// Буфер записи одной корзины, выровненный по кэш-линии
+struct alignas(CACHE_LINE) Line {
+    unsigned char bytes[CACHE_LINE];
+};
+
+template <typename Type, typename KeyFunction>
+class Partitioner {
+public:
+    Partitioner(size_t radix_bits, size_t pass_bits, KeyFunction& key)
+        : radix_bits_(radix_bits),
+        pass_bits_(pass_bits),
+        key_(key)
+    {
+    }
+
+    SimpleVector<SimpleVector<Type>> Run(const SimpleVector<Type>& items) {
+        const size_t bucket_count = size_t{1} << radix_bits_;
+        counts_ = SimpleVector<size_t>(bucket_count);
+        for (const Type& item : items) {
+            ++counts_[GetBucket(item)];
+        }
+        SimpleVector<SimpleVector<Type>> buckets(bucket_count);
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            // Scatter перезаписывает все элементы корзины
+            buckets[bucket].ResizeForOverwrite(counts_[bucket]);
+        }
+        if (!items.IsEmpty()) {
+            Partition(items.begin(), items.GetSize(), 0, radix_bits_, buckets);
+        }
+        return buckets;
+    }
+
+private:
+    size_t GetBucket(const Type& item) {
+        return static_cast<size_t>(key_(item)) & ((size_t{1} << radix_bits_) - 1);
+    }
+
+    // Раскладывает count элементов, попадающих в корзины [base, base + 2^remaining_bits)
+    void Partition(const Type* items, size_t count, size_t base, size_t remaining_bits,
+                   SimpleVector<SimpleVector<Type>>& buckets) {
+        const size_t bits = std::min(remaining_bits, pass_bits_);
+        const size_t shift = remaining_bits - bits;
+        const size_t fanout = size_t{1} << bits;
+        SimpleVector<Type*> destinations(fanout);
+        if (shift == 0) {
+            for (size_t digit = 0; digit < fanout; ++digit) {
+                destinations[digit] = buckets[base + digit].begin();
+            }
+            Scatter(items, count, shift, bits, destinations);
+            return;
+        }
+
+        // Промежуточный проход: группа digit — корзины [base + (digit << shift), base + (digit + 1) << shift)
+        SimpleVector<size_t> group_sizes(fanout);
+        for (size_t digit = 0; digit < fanout; ++digit) {
+            const size_t* const group = counts_.begin() + base + (digit << shift);
+            for (size_t i = 0; i < (size_t{1} << shift); ++i) {
+                group_sizes[digit] += group[i];
+            }
+        }
+        SimpleVector<Type> temp;
+        temp.ResizeForOverwrite(count);
+        size_t offset = 0;
+        for (size_t digit = 0; digit < fanout; ++digit) {
+            destinations[digit] = temp.begin() + offset;
+            offset += group_sizes[digit];
+        }
+        Scatter(items, count, shift, bits, destinations);
+        offset = 0;
+        for (size_t digit = 0; digit < fanout; ++digit) {
+            if (group_sizes[digit] > 0) {
+                Partition(temp.begin() + offset, group_sizes[digit], base + (digit << shift), shift, buckets);
+            }
+            offset += group_sizes[digit];
+        }
+    }
+
+    // Раскладывает элементы по destinations согласно битам [shift, shift + bits) номера корзины
+    void Scatter(const Type* items, size_t count, size_t shift, size_t bits, SimpleVector<Type*>& destinations) {
+        const size_t digit_mask = (size_t{1} << bits) - 1;
+        if constexpr (USE_WRITE_COMBINING<Type>) {
+            constexpr size_t line_items = LINE_ITEMS<Type>;
+            static_assert(line_items * sizeof(Type) == CACHE_LINE);
+            const size_t fanout = destinations.GetSize();
+            SimpleVector<Line> lines;
+            lines.ResizeForOverwrite(fanout);
+            SimpleVector<uint32_t> filled(fanout);
+            for (size_t i = 0; i < count; ++i) {
+                const size_t digit = GetBucket(items[i]) >> shift & digit_mask;
+                unsigned char* const line = lines[digit].bytes;
+                std::memcpy(line + filled[digit] * sizeof(Type), &items[i], sizeof(Type));
+                if (++filled[digit] == line_items) {
+                    std::memcpy(destinations[digit], line, CACHE_LINE);
+                    destinations[digit] += line_items;
+                    filled[digit] = 0;
+                }
+            }
+            for (size_t digit = 0; digit < fanout; ++digit) {
+                if (filled[digit] > 0) {
+                    std::memcpy(destinations[digit], lines[digit].bytes, sizeof(Type) * filled[digit]);
+                }
+            }
+        }
+        else {
+            for (size_t i = 0; i < count; ++i) {
+                const size_t digit = GetBucket(items[i]) >> shift & digit_mask;
+                *destinations[digit]++ = items[i];
+            }
+        }
+    }
+
+    size_t radix_bits_;
+    size_t pass_bits_;
+    KeyFunction& key_;
+    // Число элементов в каждой корзине
+    SimpleVector<size_t> counts_;
+};
+
+}  // namespace radix_partition_detail
+
+constexpr size_t DEFAULT_PARTITION_PASS_BITS = 8;
+
+// Разбивает items на 2^radix_bits корзин по младшим битам key(item).
+// Выбрасывает std::invalid_argument, если radix_bits или pass_bits вне [1, 24]
+template <typename Type, typename KeyFunction>
+SimpleVector<SimpleVector<Type>> RadixPartition(const SimpleVector<Type>& items, size_t radix_bits, KeyFunction key,
+                                                size_t pass_bits = DEFAULT_PARTITION_PASS_BITS) {
+    if (radix_bits == 0 || radix_bits > 24 || pass_bits == 0 || pass_bits > 24) {
+        throw std::invalid_argument("radix_bits and pass_bits must be in [1, 24]");
+    }
+    radix_partition_detail::Partitioner<Type, KeyFunction> partitioner(radix_bits, pass_bits, key);
+    return partitioner.Run(items);
+}
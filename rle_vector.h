@@ -0,0 +1,158 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "simple_vector.h"
+
+// Вектор со сжатием серий: подряд идущие равные элементы хранятся одной записью.
+// Для каждой серии хранится значение и индекс конца, поэтому доступ по индексу —
+// двоичный поиск по концам серий за O(log runs), а подсчёт и сумма
+// проходят по сериям, а не по элементам
+template <typename Type>
+class RleVector {
+public:
+    // Целые суммируются в int64_t, чтобы сумма узких типов не переполнялась
+    using SumType = std::conditional_t<std::is_integral_v<Type>, int64_t, Type>;
+
+    RleVector() = default;
+
+    explicit RleVector(const SimpleVector<Type>& items) {
+        for (const Type& item : items) {
+            PushBack(item);
+        }
+    }
+
+    size_t GetSize() const noexcept {
+        return ends_.IsEmpty() ? 0 : ends_[ends_.GetSize() - 1];
+    }
+
+    bool IsEmpty() const noexcept {
+        return ends_.IsEmpty();
+    }
+
+    size_t GetRunCount() const noexcept {
+        return values_.GetSize();
+    }
+
+    size_t GetSizeInBytes() const noexcept {
+        return sizeof(RleVector) + values_.GetCapacity() * sizeof(Type) + ends_.GetCapacity() * sizeof(size_t);
+    }
+
+    // Дописывает элемент, продлевая последнюю серию, если он равен её значению
+    void PushBack(const Type& item) {
+        AppendRun(item, 1);
+    }
+
+    // Дописывает count элементов, равных item
+    void AppendRun(const Type& item, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        const size_t end = GetSize() + count;
+        if (!values_.IsEmpty() && values_[values_.GetSize() - 1] == item) {
+            ends_[ends_.GetSize() - 1] = end;
+            return;
+        }
+        values_.PushBack(item);
+        try {
+            ends_.PushBack(end);
+        }
+        catch (...) {
+            values_.PopBack();
+            throw;
+        }
+    }
+
+    const Type& operator[](size_t index) const noexcept {
+        assert(index < GetSize());
+        return values_[FindRun(index)];
+    }
+
+    // Выбрасывает std::out_of_range, если index >= size
+    const Type& At(size_t index) const {
+        if (index >= GetSize()) {
+            throw std::out_of_range("index >= size");
+        }
+        return (*this)[index];
+    }
+
+    void Clear() noexcept {
+        values_.Clear();
+        ends_.Clear();
+    }
+
+    // Вызывает function(value, length) для каждой серии по порядку
+    template <typename Function>
+    void ForEachRun(Function function) const {
+        size_t start = 0;
+        for (size_t i = 0; i < values_.GetSize(); ++i) {
+            function(values_[i], ends_[i] - start);
+            start = ends_[i];
+        }
+    }
+
+    // Число элементов, равных value
+    size_t Count(const Type& value) const {
+        size_t count = 0;
+        ForEachRun([&](const Type& run_value, size_t length) {
+            if (run_value == value) {
+                count += length;
+            }
+        });
+        return count;
+    }
+
+    SumType Sum() const {
+        SumType sum{};
+        ForEachRun([&sum](const Type& value, size_t length) {
+            sum += static_cast<SumType>(value) * static_cast<SumType>(length);
+        });
+        return sum;
+    }
+
+    // Сумма элементов с индексами [begin, end)
+    SumType RangeSum(size_t begin, size_t end) const {
+        assert(begin <= end && end <= GetSize());
+        SumType sum{};
+        if (begin == end) {
+            return sum;
+        }
+        for (size_t run = FindRun(begin); run < values_.GetSize(); ++run) {
+            const size_t run_start = run == 0 ? 0 : ends_[run - 1];
+            const size_t from = std::max(run_start, begin);
+            const size_t to = std::min(ends_[run], end);
+            sum += static_cast<SumType>(values_[run]) * static_cast<SumType>(to - from);
+            if (ends_[run] >= end) {
+                break;
+            }
+        }
+        return sum;
+    }
+
+    // Разворачивает серии в обычный вектор
+    SimpleVector<Type> Decode() const {
+        // серии покрывают весь результат, заполнять его заранее незачем
+        SimpleVector<Type> result;
+        result.ResizeForOverwrite(GetSize());
+        Type* out = result.begin();
+        ForEachRun([&out](const Type& value, size_t length) {
+            out = std::fill_n(out, length, value);
+        });
+        return result;
+    }
+
+private:
+    // Номер серии, содержащей элемент index: первая серия с концом больше index
+    size_t FindRun(size_t index) const noexcept {
+        return static_cast<size_t>(std::upper_bound(ends_.begin(), ends_.end(), index) - ends_.begin());
+    }
+
+    SimpleVector<Type> values_;
+    // Индекс элемента после конца каждой серии, по возрастанию
+    SimpleVector<size_t> ends_;
+};
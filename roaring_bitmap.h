@@ -0,0 +1,491 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "simple_vector.h"
+
+// Сжатое множество чисел uint32_t в духе Roaring.
+// Числа делятся на блоки по 65536 значений по старшим 16 битам, и каждый блок
+// хранит младшие 16 бит в контейнере, подходящем его плотности:
+// отсортированный массив (до 4096 значений), битовая карта из 1024 слов
+// или список отрезков после RunOptimize. Пересечение, объединение и разность
+// выполняются поблочно: слияние массивов, побитовые операции над словами карт
+// или фильтрация массива по карте
+namespace roaring_detail {
+
+constexpr size_t ARRAY_MAX_SIZE = 4096;
+constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+enum class ContainerKind : uint8_t {
+    Array,
+    Bitmap,
+    Run,
+};
+
+struct Container {
+    ContainerKind kind = ContainerKind::Array;
+    uint32_t cardinality = 0;
+    // Array — отсортированные значения, Run — пары (начало, конец) включительно
+    SimpleVector<uint16_t> values;
+    // Bitmap — 1024 слова по 64 бита
+    SimpleVector<uint64_t> words;
+
+    size_t GetSizeInBytes() const noexcept {
+        return sizeof(Container) + values.GetCapacity() * sizeof(uint16_t) + words.GetCapacity() * sizeof(uint64_t);
+    }
+};
+
+inline bool TestBit(const SimpleVector<uint64_t>& words, uint16_t value) noexcept {
+    return words[value >> 6] >> (value & 63) & 1;
+}
+
+inline uint32_t CountBits(const SimpleVector<uint64_t>& words) noexcept {
+    uint32_t count = 0;
+    for (const uint64_t word : words) {
+        count += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+template <typename Function>
+void ForEachValue(const Container& c, Function& function) {
+    switch (c.kind) {
+    case ContainerKind::Array:
+        for (const uint16_t value : c.values) {
+            function(value);
+        }
+        break;
+    case ContainerKind::Bitmap:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            for (uint64_t word = c.words[i]; word != 0; word &= word - 1) {
+                function(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+            }
+        }
+        break;
+    case ContainerKind::Run:
+        for (size_t i = 0; i < c.values.GetSize(); i += 2) {
+            for (uint32_t value = c.values[i]; value <= c.values[i + 1]; ++value) {
+                function(static_cast<uint16_t>(value));
+            }
+        }
+        break;
+    }
+}
+
+inline bool Contains(const Container& c, uint16_t value) noexcept {
+    switch (c.kind) {
+    case ContainerKind::Array:
+        return std::binary_search(c.values.begin(), c.values.end(), value);
+    case ContainerKind::Bitmap:
+        return TestBit(c.words, value);
+    case ContainerKind::Run: {
+        // первый отрезок с началом больше value
+        size_t low = 0;
+        size_t high = c.values.GetSize() / 2;
+        while (low < high) {
+            const size_t middle = (low + high) / 2;
+            if (c.values[2 * middle] <= value) {
+                low = middle + 1;
+            }
+            else {
+                high = middle;
+            }
+        }
+        return low > 0 && value <= c.values[2 * low - 1];
+    }
+    }
+    return false;
+}
+
+// Создаёт карту с теми же значениями, что и в c
+inline Container MakeBitmap(const Container& c) {
+    Container result;
+    result.kind = ContainerKind::Bitmap;
+    result.cardinality = c.cardinality;
+    result.words.Resize(BITMAP_WORDS);
+    auto set_bit = [&words = result.words](uint16_t value) {
+        words[value >> 6] |= uint64_t{1} << (value & 63);
+    };
+    ForEachValue(c, set_bit);
+    return result;
+}
+
+inline Container MakeArray(const Container& c) {
+    Container result;
+    result.cardinality = c.cardinality;
+    result.values.Reserve(c.cardinality);
+    auto append = [&values = result.values](uint16_t value) {
+        values.PushBack(value);
+    };
+    ForEachValue(c, append);
+    return result;
+}
+
+// Приводит массив или карту к виду, соответствующему числу значений
+inline void Normalize(Container& c) {
+    if (c.kind == ContainerKind::Bitmap && c.cardinality <= ARRAY_MAX_SIZE) {
+        c = MakeArray(c);
+    }
+    else if (c.kind == ContainerKind::Array && c.cardinality > ARRAY_MAX_SIZE) {
+        c = MakeBitmap(c);
+    }
+}
+
+inline Container MakeArrayOrBitmap(const Container& c) {
+    return c.cardinality > ARRAY_MAX_SIZE ? MakeBitmap(c) : MakeArray(c);
+}
+
+// Для операций над парами контейнеров отрезки разворачиваются в массив или карту
+inline const Container& Expand(const Container& c, Container& scratch) {
+    if (c.kind != ContainerKind::Run) {
+        return c;
+    }
+    scratch = MakeArrayOrBitmap(c);
+    return scratch;
+}
+
+inline void Add(Container& c, uint16_t value) {
+    if (c.kind == ContainerKind::Run) {
+        c = MakeArrayOrBitmap(c);
+    }
+    if (c.kind == ContainerKind::Bitmap) {
+        uint64_t& word = c.words[value >> 6];
+        const uint64_t bit = uint64_t{1} << (value & 63);
+        c.cardinality += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+    const auto it = std::lower_bound(c.values.begin(), c.values.end(), value);
+    if (it != c.values.end() && *it == value) {
+        return;
+    }
+    c.values.Insert(it, value);
+    ++c.cardinality;
+    Normalize(c);
+}
+
+// Заменяет контейнер списком отрезков, если так он займёт меньше памяти
+inline void RunOptimize(Container& c) {
+    if (c.kind == ContainerKind::Run) {
+        return;
+    }
+    size_t runs = 0;
+    int32_t previous = -2;
+    auto count_runs = [&](uint16_t value) {
+        runs += value != previous + 1;
+        previous = value;
+    };
+    ForEachValue(c, count_runs);
+    const size_t run_bytes = runs * 2 * sizeof(uint16_t);
+    const size_t current_bytes = c.kind == ContainerKind::Array ? c.cardinality * sizeof(uint16_t)
+                                                                : BITMAP_WORDS * sizeof(uint64_t);
+    if (run_bytes >= current_bytes) {
+        return;
+    }
+    Container result;
+    result.kind = ContainerKind::Run;
+    result.cardinality = c.cardinality;
+    result.values.Reserve(2 * runs);
+    auto append = [&values = result.values](uint16_t value) {
+        if (!values.IsEmpty() && values[values.GetSize() - 1] + 1 == value) {
+            values[values.GetSize() - 1] = value;
+        }
+        else {
+            values.PushBack(value);
+            values.PushBack(value);
+        }
+    };
+    ForEachValue(c, append);
+    c = std::move(result);
+}
+
+enum class Operation {
+    And,
+    Or,
+    AndNot,
+};
+
+inline Container ArrayArray(const Container& lhs, const Container& rhs, Operation operation) {
+    Container result;
+    const SimpleVector<uint16_t>& a = lhs.values;
+    const SimpleVector<uint16_t>& b = rhs.values;
+    uint16_t* end = nullptr;
+    switch (operation) {
+    case Operation::And:
+        result.values.Resize(std::min(a.GetSize(), b.GetSize()));
+        end = std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), result.values.begin());
+        break;
+    case Operation::Or:
+        result.values.Resize(a.GetSize() + b.GetSize());
+        end = std::set_union(a.begin(), a.end(), b.begin(), b.end(), result.values.begin());
+        break;
+    case Operation::AndNot:
+        result.values.Resize(a.GetSize());
+        end = std::set_difference(a.begin(), a.end(), b.begin(), b.end(), result.values.begin());
+        break;
+    }
+    result.values.Resize(static_cast<size_t>(end - result.values.begin()));
+    result.cardinality = static_cast<uint32_t>(result.values.GetSize());
+    Normalize(result);
+    return result;
+}
+
+inline Container BitmapBitmap(const Container& lhs, const Container& rhs, Operation operation) {
+    Container result;
+    result.kind = ContainerKind::Bitmap;
+    result.words.Resize(BITMAP_WORDS);
+    uint64_t* const out = result.words.begin();
+    const uint64_t* const a = lhs.words.begin();
+    const uint64_t* const b = rhs.words.begin();
+    // простые циклы без ветвлений компилятор векторизует
+    switch (operation) {
+    case Operation::And:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            out[i] = a[i] & b[i];
+        }
+        break;
+    case Operation::Or:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            out[i] = a[i] | b[i];
+        }
+        break;
+    case Operation::AndNot:
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            out[i] = a[i] & ~b[i];
+        }
+        break;
+    }
+    result.cardinality = CountBits(result.words);
+    Normalize(result);
+    return result;
+}
+
+// Операция над массивом и картой; array_first задаёт порядок операндов для AndNot
+inline Container ArrayBitmap(const Container& array, const Container& bitmap, Operation operation, bool array_first) {
+    Container result;
+    if (operation == Operation::And || (operation == Operation::AndNot && array_first)) {
+        const bool keep_present = operation == Operation::And;
+        result.values.Resize(array.values.GetSize());
+        size_t size = 0;
+        for (const uint16_t value : array.values) {
+            result.values[size] = value;
+            size += TestBit(bitmap.words, value) == keep_present;
+        }
+        result.values.Resize(size);
+        result.cardinality = static_cast<uint32_t>(size);
+        return result;
+    }
+    // Or и AndNot(bitmap, array) изменяют копию карты
+    result = bitmap;
+    for (const uint16_t value : array.values) {
+        uint64_t& word = result.words[value >> 6];
+        const uint64_t bit = uint64_t{1} << (value & 63);
+        if (operation == Operation::Or) {
+            result.cardinality += (word & bit) == 0;
+            word |= bit;
+        }
+        else {
+            result.cardinality -= (word & bit) != 0;
+            word &= ~bit;
+        }
+    }
+    Normalize(result);
+    return result;
+}
+
+inline Container Combine(const Container& lhs, const Container& rhs, Operation operation) {
+    Container lhs_scratch;
+    Container rhs_scratch;
+    const Container& a = Expand(lhs, lhs_scratch);
+    const Container& b = Expand(rhs, rhs_scratch);
+    if (a.kind == ContainerKind::Array && b.kind == ContainerKind::Array) {
+        return ArrayArray(a, b, operation);
+    }
+    if (a.kind == ContainerKind::Bitmap && b.kind == ContainerKind::Bitmap) {
+        return BitmapBitmap(a, b, operation);
+    }
+    if (a.kind == ContainerKind::Array) {
+        return ArrayBitmap(a, b, operation, true);
+    }
+    return ArrayBitmap(b, a, operation, false);
+}
+
+}  // namespace roaring_detail
+
+class RoaringBitmap {
+public:
+    RoaringBitmap() = default;
+
+    // Строит множество по возрастающей последовательности, повторы допускаются.
+    // Выбрасывает std::invalid_argument, если значения не отсортированы
+    explicit RoaringBitmap(const SimpleVector<uint32_t>& sorted_values) {
+        size_t begin = 0;
+        while (begin < sorted_values.GetSize()) {
+            const uint16_t key = static_cast<uint16_t>(sorted_values[begin] >> 16);
+            size_t end = begin;
+            roaring_detail::Container container;
+            while (end < sorted_values.GetSize() && sorted_values[end] >> 16 == key) {
+                if (end > begin && sorted_values[end] < sorted_values[end - 1]) {
+                    throw std::invalid_argument("values are not sorted");
+                }
+                const uint16_t low = static_cast<uint16_t>(sorted_values[end]);
+                if (container.values.IsEmpty() || container.values[container.values.GetSize() - 1] != low) {
+                    container.values.PushBack(low);
+                }
+                ++end;
+            }
+            if (end < sorted_values.GetSize() && sorted_values[end] < sorted_values[end - 1]) {
+                throw std::invalid_argument("values are not sorted");
+            }
+            container.cardinality = static_cast<uint32_t>(container.values.GetSize());
+            roaring_detail::Normalize(container);
+            keys_.PushBack(key);
+            containers_.PushBack(std::move(container));
+            begin = end;
+        }
+    }
+
+    void Add(uint32_t value) {
+        const uint16_t key = static_cast<uint16_t>(value >> 16);
+        const size_t index = FindKey(key);
+        if (index == keys_.GetSize() || keys_[index] != key) {
+            // память резервируется до вставок: после первой вставки вторая уже не выбросит
+            // bad_alloc, и ключи не разойдутся с контейнерами
+            ReserveForInsert(keys_);
+            ReserveForInsert(containers_);
+            containers_.Insert(containers_.begin() + index, roaring_detail::Container());
+            keys_.Insert(keys_.begin() + index, key);
+        }
+        roaring_detail::Add(containers_[index], static_cast<uint16_t>(value));
+    }
+
+    bool Contains(uint32_t value) const noexcept {
+        const uint16_t key = static_cast<uint16_t>(value >> 16);
+        const size_t index = FindKey(key);
+        return index < keys_.GetSize() && keys_[index] == key
+            && roaring_detail::Contains(containers_[index], static_cast<uint16_t>(value));
+    }
+
+    uint64_t GetCardinality() const noexcept {
+        uint64_t cardinality = 0;
+        for (const auto& container : containers_) {
+            cardinality += container.cardinality;
+        }
+        return cardinality;
+    }
+
+    bool IsEmpty() const noexcept {
+        return containers_.IsEmpty();
+    }
+
+    // Переводит в списки отрезков контейнеры, которые так займут меньше памяти
+    void RunOptimize() {
+        for (auto& container : containers_) {
+            roaring_detail::RunOptimize(container);
+        }
+    }
+
+    size_t GetSizeInBytes() const noexcept {
+        size_t bytes = sizeof(RoaringBitmap) + keys_.GetCapacity() * sizeof(uint16_t)
+            + (containers_.GetCapacity() - containers_.GetSize()) * sizeof(roaring_detail::Container);
+        for (const auto& container : containers_) {
+            bytes += container.GetSizeInBytes();
+        }
+        return bytes;
+    }
+
+    // Вызывает function для каждого значения в порядке возрастания
+    template <typename Function>
+    void ForEach(Function function) const {
+        for (size_t i = 0; i < keys_.GetSize(); ++i) {
+            const uint32_t high = static_cast<uint32_t>(keys_[i]) << 16;
+            auto call = [&](uint16_t low) {
+                function(high | low);
+            };
+            roaring_detail::ForEachValue(containers_[i], call);
+        }
+    }
+
+    SimpleVector<uint32_t> ToVector() const {
+        SimpleVector<uint32_t> result;
+        result.Reserve(GetCardinality());
+        ForEach([&result](uint32_t value) {
+            result.PushBack(value);
+        });
+        return result;
+    }
+
+    friend RoaringBitmap And(const RoaringBitmap& lhs, const RoaringBitmap& rhs) {
+        return Combine(lhs, rhs, roaring_detail::Operation::And);
+    }
+
+    friend RoaringBitmap Or(const RoaringBitmap& lhs, const RoaringBitmap& rhs) {
+        return Combine(lhs, rhs, roaring_detail::Operation::Or);
+    }
+
+    friend RoaringBitmap AndNot(const RoaringBitmap& lhs, const RoaringBitmap& rhs) {
+        return Combine(lhs, rhs, roaring_detail::Operation::AndNot);
+    }
+
+private:
+    // Резервирует место под ещё один элемент, удваивая вместимость, как PushBack
+    template <typename Item>
+    static void ReserveForInsert(SimpleVector<Item>& items) {
+        if (items.GetSize() == items.GetCapacity()) {
+            items.Reserve(std::max<size_t>(1, 2 * items.GetCapacity()));
+        }
+    }
+
+    size_t FindKey(uint16_t key) const noexcept {
+        return static_cast<size_t>(std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin());
+    }
+
+    void Append(uint16_t key, roaring_detail::Container&& container) {
+        if (container.cardinality > 0) {
+            keys_.PushBack(key);
+            containers_.PushBack(std::move(container));
+        }
+    }
+
+    // Проходит по ключам обоих множеств слиянием. Блоки, которые есть только в одном
+    // множестве, копируются или пропускаются в зависимости от операции
+    static RoaringBitmap Combine(const RoaringBitmap& lhs, const RoaringBitmap& rhs, roaring_detail::Operation operation) {
+        using roaring_detail::Operation;
+        RoaringBitmap result;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < lhs.keys_.GetSize() || j < rhs.keys_.GetSize()) {
+            const bool has_lhs = i < lhs.keys_.GetSize();
+            const bool has_rhs = j < rhs.keys_.GetSize();
+            if (has_lhs && has_rhs && lhs.keys_[i] == rhs.keys_[j]) {
+                result.Append(lhs.keys_[i], roaring_detail::Combine(lhs.containers_[i], rhs.containers_[j], operation));
+                ++i;
+                ++j;
+            }
+            else if (has_lhs && (!has_rhs || lhs.keys_[i] < rhs.keys_[j])) {
+                if (operation != Operation::And) {
+                    result.Append(lhs.keys_[i], roaring_detail::Container(lhs.containers_[i]));
+                }
+                ++i;
+            }
+            else {
+                if (operation == Operation::Or) {
+                    result.Append(rhs.keys_[j], roaring_detail::Container(rhs.containers_[j]));
+                }
+                else if (operation == Operation::And && !has_lhs) {
+                    break;
+                }
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    // Старшие 16 бит значений по возрастанию и контейнеры с младшими битами
+    SimpleVector<uint16_t> keys_;
+    SimpleVector<roaring_detail::Container> containers_;
+};
@@ -3,11 +3,55 @@
 #include <cassert>
 #include <initializer_list>
 #include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <stdexcept>
 
 #include "array_ptr.h"
 
+#ifdef SIMPLE_VECTOR_TRACE
+#include "vector_trace.h"
+#define SIMPLE_VECTOR_TRACE_OP(op, ...) vector_trace::RecordOp(vector_trace::Op::op, this __VA_OPT__(,) __VA_ARGS__)
+#else
+#define SIMPLE_VECTOR_TRACE_OP(op, ...)
+#endif
+
+#ifdef SIMPLE_VECTOR_LATENCY
+#include "vector_latency.h"
+#define SIMPLE_VECTOR_LATENCY_SCOPE(op) vector_latency::SampleScope latency_scope(vector_latency::Op::op)
+#else
+#define SIMPLE_VECTOR_LATENCY_SCOPE(op)
+#endif
+
+#ifdef SIMPLE_VECTOR_PROFILE
+#include <source_location>
+#include "vector_profile.h"
+// Конструкторы получают дополнительный параметр — место создания вектора
+#define SIMPLE_VECTOR_PROFILE_SITE std::source_location profile_site = std::source_location::current()
+#define SIMPLE_VECTOR_PROFILE_SITE_ARG , SIMPLE_VECTOR_PROFILE_SITE
+#define SIMPLE_VECTOR_PROFILE_START() profile_site_ = profile_site
+#define SIMPLE_VECTOR_PROFILE_OP(call) profile_stats_.call
+#define SIMPLE_VECTOR_PROFILE_REPORT() vector_profile::Report(profile_site_, profile_stats_)
+// Счётчики и место создания переходят вместе с буфером
+#define SIMPLE_VECTOR_PROFILE_TAKE(other) \
+    profile_site_ = (other).profile_site_; \
+    profile_stats_ = std::exchange((other).profile_stats_, vector_profile::InstanceStats())
+#define SIMPLE_VECTOR_PROFILE_SWAP(other) \
+    std::swap(profile_site_, (other).profile_site_); \
+    std::swap(profile_stats_, (other).profile_stats_)
+#else
+#define SIMPLE_VECTOR_PROFILE_SITE
+#define SIMPLE_VECTOR_PROFILE_SITE_ARG
+#define SIMPLE_VECTOR_PROFILE_START()
+#define SIMPLE_VECTOR_PROFILE_OP(call)
+#define SIMPLE_VECTOR_PROFILE_REPORT()
+#define SIMPLE_VECTOR_PROFILE_TAKE(other)
+#define SIMPLE_VECTOR_PROFILE_SWAP(other)
+#endif
+
 class ReserveProxyObj {
 public:
     size_t capacity_ = 0;
@@ -23,52 +67,69 @@ public:
     using Iterator = Type*;
     using ConstIterator = const Type*;
 
-    SimpleVector() noexcept = default;
+    SimpleVector(SIMPLE_VECTOR_PROFILE_SITE) noexcept {
+        SIMPLE_VECTOR_PROFILE_START();
+        SIMPLE_VECTOR_TRACE_OP(Construct);
+    }
 
     // Создаёт вектор из size элементов, инициализированных значением по умолчанию
-    explicit SimpleVector(size_t size) 
+    explicit SimpleVector(size_t size SIMPLE_VECTOR_PROFILE_SITE_ARG) 
         : size_(size), 
         capacity_(size),
         items_(size)
     {
+        SIMPLE_VECTOR_PROFILE_START();
+        SIMPLE_VECTOR_TRACE_OP(Construct, size);
     }
 
-    explicit SimpleVector(const ReserveProxyObj& reserve) 
+    explicit SimpleVector(const ReserveProxyObj& reserve SIMPLE_VECTOR_PROFILE_SITE_ARG) 
         : capacity_(reserve.capacity_),
         items_(reserve.capacity_)
     {
+        SIMPLE_VECTOR_PROFILE_START();
+        SIMPLE_VECTOR_PROFILE_OP(OnReserve());
+        SIMPLE_VECTOR_TRACE_OP(Construct);
+        SIMPLE_VECTOR_TRACE_OP(Reserve, reserve.capacity_);
     }
 
     // Создаёт вектор из size элементов, инициализированных значением value
-    SimpleVector(size_t size, const Type& value) 
+    SimpleVector(size_t size, const Type& value SIMPLE_VECTOR_PROFILE_SITE_ARG) 
         : size_(size), 
         capacity_(size),
         items_(size)
     {
+        SIMPLE_VECTOR_PROFILE_START();
         std::fill(begin(), end(), value);
+        SIMPLE_VECTOR_TRACE_OP(Construct, size);
     }
 
     // Создаёт вектор из std::initializer_list
-    SimpleVector(std::initializer_list<Type> init) 
+    SimpleVector(std::initializer_list<Type> init SIMPLE_VECTOR_PROFILE_SITE_ARG) 
         : size_(init.size()), 
         capacity_(init.size()),
         items_(init.size())
     {
+        SIMPLE_VECTOR_PROFILE_START();
         std::copy(init.begin(), init.end(), begin());
+        SIMPLE_VECTOR_TRACE_OP(Construct, init.size());
     }
 
-    SimpleVector(const SimpleVector& other) 
+    SimpleVector(const SimpleVector& other SIMPLE_VECTOR_PROFILE_SITE_ARG) 
         : size_(other.size_),
         capacity_(other.capacity_),
         items_(other.capacity_)
     {
+        SIMPLE_VECTOR_PROFILE_START();
         std::copy(other.begin(), other.end(), begin());
+        SIMPLE_VECTOR_TRACE_OP(CopyConstruct, &other);
     }
 
     SimpleVector& operator=(const SimpleVector& rhs) {
         if (this != &rhs) {
             SimpleVector rhs_copy(rhs);
             swap(rhs_copy);
+            // копия создана внутри operator=: место и счётчики остаются у этого вектора
+            SIMPLE_VECTOR_PROFILE_SWAP(rhs_copy);
         }
         return *this;
     }
@@ -78,10 +139,16 @@ public:
         capacity_(std::exchange(other.capacity_, 0)),
         items_(std::move(other.items_))
     {
+        SIMPLE_VECTOR_PROFILE_TAKE(other);
+        SIMPLE_VECTOR_TRACE_OP(MoveConstruct, &other);
     }
 
     SimpleVector& operator=(SimpleVector&& other) noexcept {
         if (this != &other) {
+            SIMPLE_VECTOR_TRACE_OP(MoveAssign, &other);
+            // прежний буфер освобождается: его счётчики отчитываются сейчас
+            SIMPLE_VECTOR_PROFILE_REPORT();
+            SIMPLE_VECTOR_PROFILE_TAKE(other);
             size_ = std::exchange(other.size_, 0);
             capacity_ = std::exchange(other.capacity_, 0);
             items_ = std::move(other.items_);
@@ -89,6 +156,13 @@ public:
         return *this;
     }
 
+#if defined(SIMPLE_VECTOR_TRACE) || defined(SIMPLE_VECTOR_PROFILE)
+    ~SimpleVector() {
+        SIMPLE_VECTOR_TRACE_OP(Destroy);
+        SIMPLE_VECTOR_PROFILE_REPORT();
+    }
+#endif
+
     // Возвращает количество элементов в массиве
     size_t GetSize() const noexcept {
         return size_;
@@ -140,17 +214,21 @@ public:
 
     // Обнуляет размер массива, не изменяя его вместимость
     void Clear() noexcept {
+        SIMPLE_VECTOR_TRACE_OP(Clear);
         size_ = 0;
     }
 
     // Изменяет размер массива.
     // При увеличении размера новые элементы получают значение по умолчанию для типа Type
     void Resize(size_t new_size) {
+        SIMPLE_VECTOR_TRACE_OP(Resize, new_size);
+        SIMPLE_VECTOR_PROFILE_OP(OnResize(new_size));
         if(new_size > size_ && new_size <= capacity_) {
             std::fill(begin() + size_, begin() + new_size, Type());
         }
         else if(new_size > capacity_){
             auto new_capacity = std::max(new_size, 2 * capacity_);
+            SIMPLE_VECTOR_PROFILE_OP(OnReallocate());
             ArrayPtr<Type> copy(new_capacity);
             std::move(begin(), end(), copy.Get());
             items_.swap(copy);
@@ -159,10 +237,22 @@ public:
         size_ = new_size;
     }
 
+    // Изменяет размер массива, не заполняя новые элементы значением по умолчанию:
+    // вызывающий код обязан перезаписать их до чтения. Для тривиальных типов
+    // новая память при перевыделении тоже не заполняется
+    void ResizeForOverwrite(size_t new_size) {
+        SIMPLE_VECTOR_TRACE_OP(Resize, new_size);
+        SIMPLE_VECTOR_PROFILE_OP(OnResize(new_size));
+        ResizeBeforeMove(new_size);
+    }
+
     // Изменяет размер capacity
     //Если new_capacity > capacity_ нужно выделить новое место под массив и скопировать все элементы
     void Reserve(size_t new_capacity) {
+        SIMPLE_VECTOR_TRACE_OP(Reserve, new_capacity);
+        SIMPLE_VECTOR_PROFILE_OP(OnReserve());
         if (new_capacity > capacity_) {
+            SIMPLE_VECTOR_PROFILE_OP(OnReallocate());
             ArrayPtr<Type> copy(new_capacity);
             std::move(begin(), end(), copy.Get());
             items_.swap(copy);
@@ -170,6 +260,18 @@ public:
         }
     }
 
+    // Уменьшает вместимость до размера, перенося элементы в буфер точного размера.
+    // На время переноса заняты оба буфера
+    void ShrinkToFit() {
+        SIMPLE_VECTOR_TRACE_OP(ShrinkToFit);
+        if (capacity_ > size_) {
+            ArrayPtr<Type> copy = size_ > 0 ? ArrayPtr<Type>(size_) : ArrayPtr<Type>();
+            std::move(begin(), end(), copy.Get());
+            items_.swap(copy);
+            capacity_ = size_;
+        }
+    }
+
     // Возвращает итератор на начало массива
     // Для пустого массива может быть равен (или не равен) nullptr
     Iterator begin() noexcept {
@@ -209,14 +311,20 @@ public:
     // Добавляет элемент в конец вектора
     // При нехватке места увеличивает вдвое вместимость вектора
     void PushBack(const Type& item) {
-        Resize(size_ + 1);
+        SIMPLE_VECTOR_LATENCY_SCOPE(PushBack);
+        SIMPLE_VECTOR_TRACE_OP(PushBack);
+        ResizeBeforeMove(size_ + 1);
+        SIMPLE_VECTOR_PROFILE_OP(OnPushBack(size_));
         items_[size_ - 1] = item;
     }
 
     // Добавляет элемент в конец вектора
     // При нехватке места увеличивает вдвое вместимость вектора
     void PushBack(Type&& item) {
+        SIMPLE_VECTOR_LATENCY_SCOPE(PushBack);
+        SIMPLE_VECTOR_TRACE_OP(PushBack);
         ResizeBeforeMove(size_ + 1);
+        SIMPLE_VECTOR_PROFILE_OP(OnPushBack(size_));
         items_[size_ - 1] = std::move(item);
     }
 
@@ -225,8 +333,11 @@ public:
     // Если перед вставкой значения вектор был заполнен полностью,
     // вместимость вектора должна увеличиться вдвое, а для вектора вместимостью 0 стать равной 1
     Iterator Insert(ConstIterator pos, const Type& value) {
+        SIMPLE_VECTOR_LATENCY_SCOPE(Insert);
         size_t index = pos - begin();
-        Resize(size_ + 1);
+        SIMPLE_VECTOR_TRACE_OP(Insert, index);
+        SIMPLE_VECTOR_PROFILE_OP(OnInsert(index, size_));
+        ResizeBeforeMove(size_ + 1);
         std::move_backward(begin() + index, end() - 1, end());
         items_[index] = value;
         return &items_[index];
@@ -237,7 +348,10 @@ public:
     // Если перед вставкой значения вектор был заполнен полностью,
     // вместимость вектора должна увеличиться вдвое, а для вектора вместимостью 0 стать равной 1
     Iterator Insert(ConstIterator pos, Type&& value) {
+        SIMPLE_VECTOR_LATENCY_SCOPE(Insert);
         size_t index = pos - begin();
+        SIMPLE_VECTOR_TRACE_OP(Insert, index);
+        SIMPLE_VECTOR_PROFILE_OP(OnInsert(index, size_));
         ResizeBeforeMove(size_ + 1);
         std::move_backward(begin() + index, end() - 1, end());
         items_[index] = std::move(value);
@@ -248,29 +362,61 @@ public:
     // "Удаляет" последний элемент вектора. Вектор не должен быть пустым
     void PopBack() noexcept {
         assert(!IsEmpty());
+        SIMPLE_VECTOR_TRACE_OP(PopBack);
         --size_;
     }
 
     // Удаляет элемент вектора в указанной позиции
     Iterator Erase(ConstIterator pos) {
         assert(pos != end());
+        SIMPLE_VECTOR_LATENCY_SCOPE(Erase);
         size_t index = pos - begin();
+        SIMPLE_VECTOR_TRACE_OP(Erase, index);
+        SIMPLE_VECTOR_PROFILE_OP(OnErase(index, size_));
         std::move(begin() + index + 1, end(), begin() + index);
         --size_;
         return &items_[index];
     }
 
     void swap(SimpleVector& other) noexcept {
+        SIMPLE_VECTOR_TRACE_OP(Swap, &other);
+        SIMPLE_VECTOR_PROFILE_SWAP(other);
         items_.swap(other.items_);
         std::swap(capacity_, other.capacity_);
         std::swap(size_, other.size_);
     }
 
 private:
+    template <typename>
+    friend class SimpleVector;
+
+    template <typename Result, typename Source, typename Function>
+    friend SimpleVector<Result> TransformInto(SimpleVector<Source>&& source, Function function);
+
+    // Забирает буфер source, в начале которого уже созданы source.GetSize() элементов Type.
+    // В остальной вместимости объекты Type создаются здесь (для тривиального типа это
+    // не стоит ни одной инструкции), поэтому весь буфер становится массивом Type
+    template <typename Source>
+    void AdoptBuffer(SimpleVector<Source>& source) noexcept {
+        SIMPLE_VECTOR_TRACE_OP(MoveAssign, &source);
+        const size_t size = std::exchange(source.size_, 0);
+        const size_t capacity = std::exchange(source.capacity_, 0) * sizeof(Source) / sizeof(Type);
+        if (capacity > size) {
+            unsigned char* const bytes = reinterpret_cast<unsigned char*>(source.items_.Get());
+            std::uninitialized_default_construct_n(reinterpret_cast<Type*>(bytes + size * sizeof(Type)), capacity - size);
+        }
+        items_ = ArrayPtr<Type>::FromStorage(std::move(source.items_));
+        size_ = size;
+        capacity_ = capacity;
+    }
+
+    // Изменяет размер без заполнения новых элементов значением по умолчанию:
+    // вызывающий код сразу же перезаписывает их
     void ResizeBeforeMove(size_t new_size) {
         if (new_size > capacity_) {
             auto new_capacity = std::max(new_size, 2 * capacity_);
-            ArrayPtr<Type> copy(new_capacity);
+            SIMPLE_VECTOR_PROFILE_OP(OnReallocate());
+            ArrayPtr<Type> copy = ArrayPtr<Type>::Uninitialized(new_capacity);
             std::move(begin(), end(), copy.Get());
             items_.swap(copy);
             capacity_ = new_capacity;
@@ -281,8 +427,57 @@ private:
     size_t size_ = 0;
     size_t capacity_ = 0;
     ArrayPtr<Type> items_;
+#ifdef SIMPLE_VECTOR_PROFILE
+    std::source_location profile_site_;
+    vector_profile::InstanceStats profile_stats_;
+#endif
 };
 
+// Буфер вектора Source можно отдать вектору Result, если оба типа хранятся
+// в сырой памяти (ArrayPtr::RAW_STORAGE): буфер выделен ::operator new[] и
+// освобождается ::operator delete[] независимо от типа элементов. Кроме того,
+// элемент Result не больше элемента Source, а перенос байтов корректен для обоих типов
+template <typename Source, typename Result>
+inline constexpr bool CAN_REUSE_BUFFER = ArrayPtr<Source>::RAW_STORAGE && ArrayPtr<Result>::RAW_STORAGE
+    && std::is_trivially_copyable_v<Source> && std::is_trivially_copyable_v<Result>
+    && sizeof(Result) <= sizeof(Source);
+
+// Преобразует элементы source функцией function в вектор Result.
+// Если позволяют типы (CAN_REUSE_BUFFER), результат пишется в буфер source
+// без нового выделения памяти: элементы обрабатываются по возрастанию индекса,
+// и i-й результат создаётся placement new в байтах, уже прочитанных из элементов
+// с индексами <= i, поэтому время жизни этих элементов Source завершается законно.
+// Иначе память выделяется заново. В обоих случаях source после вызова пуст,
+// в том числе если function выбросила исключение
+template <typename Result, typename Source, typename Function>
+SimpleVector<Result> TransformInto(SimpleVector<Source>&& source, Function function) {
+    SimpleVector<Result> result;
+    if constexpr (CAN_REUSE_BUFFER<Source, Result>) {
+        Source* const items = source.begin();
+        unsigned char* const bytes = reinterpret_cast<unsigned char*>(items);
+        const size_t size = source.GetSize();
+        try {
+            for (size_t i = 0; i < size; ++i) {
+                const Result transformed = function(items[i]);
+                ::new (static_cast<void*>(bytes + i * sizeof(Result))) Result(transformed);
+            }
+        }
+        catch (...) {
+            source.Clear();
+            throw;
+        }
+        result.AdoptBuffer(source);
+    }
+    else {
+        SimpleVector<Source> consumed(std::move(source));
+        result.Reserve(consumed.GetSize());
+        for (Source& item : consumed) {
+            result.PushBack(function(std::move(item)));
+        }
+    }
+    return result;
+}
+
 template <typename Type>
 inline bool operator==(const SimpleVector<Type>& lhs, const SimpleVector<Type>& rhs) {
     return lhs.GetSize() == rhs.GetSize() ? std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(), rhs.cend()) : false;
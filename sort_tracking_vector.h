@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "simple_vector.h"
+
+// Вектор, который помнит, отсортированы ли его элементы.
+// Каждое изменение проверяет порядок только рядом с изменённой позицией:
+// PushBack сравнивает с последним элементом, Insert и Set — с соседями,
+// а удаление порядок не нарушает. Пока элементы отсортированы, Find, Contains
+// и Count ищут двоичным поиском, иначе — линейным проходом.
+// Запись идёт через Set; прямой доступ на запись через Mutate сбрасывает признак,
+// и вернуть его можно вызовом Sort или CheckSorted
+template <typename Type, typename Compare = std::less<Type>>
+class SortTrackingVector {
+public:
+    using ConstIterator = const Type*;
+
+    SortTrackingVector() = default;
+
+    // Проверяет порядок items за O(n)
+    explicit SortTrackingVector(SimpleVector<Type> items, Compare compare = Compare())
+        : items_(std::move(items)),
+        compare_(compare)
+    {
+        CheckSorted();
+    }
+
+    size_t GetSize() const noexcept {
+        return items_.GetSize();
+    }
+
+    bool IsEmpty() const noexcept {
+        return items_.IsEmpty();
+    }
+
+    bool IsSorted() const noexcept {
+        return sorted_;
+    }
+
+    const Type& operator[](size_t index) const noexcept {
+        return items_[index];
+    }
+
+    // Выбрасывает std::out_of_range, если index >= size
+    const Type& At(size_t index) const {
+        return items_.At(index);
+    }
+
+    ConstIterator begin() const noexcept {
+        return items_.begin();
+    }
+
+    ConstIterator end() const noexcept {
+        return items_.end();
+    }
+
+    const SimpleVector<Type>& GetItems() const noexcept {
+        return items_;
+    }
+
+    void PushBack(Type item) {
+        const bool keeps_order = !sorted_ || items_.IsEmpty() || !compare_(item, items_[items_.GetSize() - 1]);
+        items_.PushBack(std::move(item));
+        sorted_ = keeps_order;
+    }
+
+    ConstIterator Insert(ConstIterator pos, Type item) {
+        const size_t index = static_cast<size_t>(pos - begin());
+        const bool keeps_order = sorted_ && FitsAt(index, index, item);
+        const ConstIterator result = items_.Insert(pos, std::move(item));
+        sorted_ = keeps_order;
+        return result;
+    }
+
+    // Заменяет элемент index
+    void Set(size_t index, Type item) {
+        assert(index < GetSize());
+        const bool keeps_order = sorted_ && FitsAt(index, index + 1, item);
+        items_[index] = std::move(item);
+        sorted_ = keeps_order;
+    }
+
+    ConstIterator Erase(ConstIterator pos) {
+        return items_.Erase(pos);
+    }
+
+    void PopBack() noexcept {
+        items_.PopBack();
+    }
+
+    void Clear() noexcept {
+        items_.Clear();
+        sorted_ = true;
+    }
+
+    void Reserve(size_t capacity) {
+        items_.Reserve(capacity);
+    }
+
+    // Даёт прямой доступ к элементам. Порядок после этого неизвестен
+    SimpleVector<Type>& Mutate() noexcept {
+        sorted_ = false;
+        return items_;
+    }
+
+    void Sort() {
+        if (!sorted_) {
+            std::sort(items_.begin(), items_.end(), compare_);
+            sorted_ = true;
+        }
+    }
+
+    // Проверяет порядок за O(n) и возвращает результат
+    bool CheckSorted() {
+        sorted_ = std::is_sorted(items_.begin(), items_.end(), compare_);
+        return sorted_;
+    }
+
+    // Первый элемент, равный value, или end(). Эквивалентные по compare_ элементы
+    // могут быть не равны value, поэтому среди них равный ищется линейно
+    ConstIterator Find(const Type& value) const {
+        if (sorted_) {
+            const auto [first, last] = std::equal_range(begin(), end(), value, compare_);
+            const ConstIterator it = std::find(first, last, value);
+            return it != last ? it : end();
+        }
+        return std::find(begin(), end(), value);
+    }
+
+    bool Contains(const Type& value) const {
+        return Find(value) != end();
+    }
+
+    size_t Count(const Type& value) const {
+        if (sorted_) {
+            const auto [first, last] = std::equal_range(begin(), end(), value, compare_);
+            return static_cast<size_t>(std::count(first, last, value));
+        }
+        return static_cast<size_t>(std::count(begin(), end(), value));
+    }
+
+    // Отдаёт элементы. Вектор становится пустым
+    SimpleVector<Type> Release() {
+        sorted_ = true;
+        return std::move(items_);
+    }
+
+private:
+    // Сообщает, останется ли порядок, если item окажется между элементами
+    // с индексами before - 1 и after
+    bool FitsAt(size_t before, size_t after, const Type& item) const {
+        return (before == 0 || !compare_(item, items_[before - 1]))
+            && (after >= items_.GetSize() || !compare_(items_[after], item));
+    }
+
+    SimpleVector<Type> items_;
+    bool sorted_ = true;
+    Compare compare_;
+};
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "simple_vector.h"
+
+// Построитель строк поверх SimpleVector<char>.
+// Символы пишутся прямо в свободную вместимость буфера: размер вектора всегда равен
+// его вместимости, а длина строки хранится отдельно, поэтому дописывание не заполняет
+// новые элементы значением по умолчанию. Числа форматируются std::to_chars без
+// промежуточных строк, вместимость растёт вдвое
+class StringBuilder {
+public:
+    StringBuilder() = default;
+
+    explicit StringBuilder(size_t capacity) {
+        Reallocate(capacity);
+    }
+
+    size_t GetSize() const noexcept {
+        return size_;
+    }
+
+    size_t GetCapacity() const noexcept {
+        return buffer_.GetSize();
+    }
+
+    bool IsEmpty() const noexcept {
+        return size_ == 0;
+    }
+
+    // Возвращает накопленную строку. Представление действительно до следующего изменения
+    std::string_view View() const noexcept {
+        return std::string_view(buffer_.begin(), size_);
+    }
+
+    void Clear() noexcept {
+        size_ = 0;
+    }
+
+    void Reserve(size_t capacity) {
+        if (capacity > buffer_.GetSize()) {
+            Reallocate(capacity);
+        }
+    }
+
+    StringBuilder& Append(std::string_view text) {
+        if (!text.empty()) {
+            std::memcpy(Grow(text.size()), text.data(), text.size());
+            size_ += text.size();
+        }
+        return *this;
+    }
+
+    // Без этой перегрузки строковый литерал выбрал бы Append(bool)
+    StringBuilder& Append(const char* text) {
+        return Append(std::string_view(text));
+    }
+
+    StringBuilder& Append(char c) {
+        *Grow(1) = c;
+        ++size_;
+        return *this;
+    }
+
+    // Дописывает целое число в десятичной записи
+    template <typename Integer,
+              std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, char>
+                               && !std::is_same_v<Integer, bool>, int> = 0>
+    StringBuilder& Append(Integer value) {
+        // знак и все цифры
+        constexpr size_t max_length = std::numeric_limits<Integer>::digits10 + 2;
+        char* const begin = Grow(max_length);
+        size_ = std::to_chars(begin, begin + max_length, value).ptr - buffer_.begin();
+        return *this;
+    }
+
+    // Дописывает число с плавающей точкой в кратчайшей записи, читающейся обратно без потерь
+    StringBuilder& Append(double value) {
+        constexpr size_t max_length = 32;
+        char* const begin = Grow(max_length);
+        size_ = std::to_chars(begin, begin + max_length, value).ptr - buffer_.begin();
+        return *this;
+    }
+
+    // Дописывает число с плавающей точкой с precision знаками после запятой
+    StringBuilder& AppendFixed(double value, int precision) {
+        // знак, до 309 цифр целой части, точка и дробная часть
+        const size_t max_length = 312 + static_cast<size_t>(std::max(precision, 0));
+        char* const begin = Grow(max_length);
+        size_ = std::to_chars(begin, begin + max_length, value, std::chars_format::fixed, precision).ptr
+            - buffer_.begin();
+        return *this;
+    }
+
+    StringBuilder& Append(bool value) {
+        return Append(value ? std::string_view("true") : std::string_view("false"));
+    }
+
+    template <typename Value>
+    StringBuilder& operator<<(const Value& value) {
+        return Append(value);
+    }
+
+    // Отдаёт накопленную строку, не копируя её. Построитель становится пустым
+    SimpleVector<char> Release() {
+        buffer_.Resize(size_);
+        size_ = 0;
+        return std::move(buffer_);
+    }
+
+private:
+    // Гарантирует место для count символов и возвращает указатель на конец строки
+    char* Grow(size_t count) {
+        const size_t required = size_ + count;
+        if (required > buffer_.GetSize()) {
+            Reallocate(std::max({required, 2 * buffer_.GetSize(), MIN_CAPACITY}));
+        }
+        return buffer_.begin() + size_;
+    }
+
+    void Reallocate(size_t capacity) {
+        // Переносится только строка, а не вся прежняя вместимость;
+        // новая память не заполняется нулями
+        SimpleVector<char> new_buffer;
+        new_buffer.ResizeForOverwrite(capacity);
+        if (size_ > 0) {
+            std::memcpy(new_buffer.begin(), buffer_.begin(), size_);
+        }
+        buffer_.swap(new_buffer);
+    }
+
+    static constexpr size_t MIN_CAPACITY = 64;
+
+    SimpleVector<char> buffer_;
+    size_t size_ = 0;
+};
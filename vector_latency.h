@@ -0,0 +1,342 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Выборочное измерение задержек операций SimpleVector.
+// Включается определением макроса SIMPLE_VECTOR_LATENCY до подключения simple_vector.h.
+// Измеряется каждая N-я операция потока (N задаёт SetSamplingRate, 0 — измерения выключены),
+// результат попадает в гистограмму потока. Snapshot и Dump собирают гистограммы всех потоков
+namespace vector_latency {
+
+enum class Op : uint8_t {
+    PushBack,
+    Insert,
+    Erase,
+};
+
+constexpr size_t OP_COUNT = 3;
+
+inline const char* GetOpName(Op op) {
+    switch (op) {
+    case Op::PushBack:
+        return "PushBack";
+    case Op::Insert:
+        return "Insert";
+    default:
+        return "Erase";
+    }
+}
+
+// Текущее время в тиках: rdtsc на x86, иначе наносекунды steady_clock
+inline uint64_t Now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Число тиков Now() в одной наносекунде. Для rdtsc измеряется один раз при первом вызове
+inline double GetTicksPerNanosecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const double ticks_per_ns = [] {
+        const auto start_time = std::chrono::steady_clock::now();
+        const uint64_t start_ticks = Now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint64_t ticks = Now() - start_ticks;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        return static_cast<double>(ticks) / ns;
+    }();
+    return ticks_per_ns;
+#else
+    return 1.0;
+#endif
+}
+
+// Лог-линейная гистограмма в духе HDR Histogram: значения до SUB_BUCKET_COUNT хранятся точно,
+// остальные — в корзинах шириной 1/SUB_BUCKET_COUNT от своей степени двойки (погрешность ~3%)
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    static size_t GetBucketIndex(uint64_t value) noexcept {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const int shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) & (SUB_BUCKET_COUNT - 1));
+    }
+
+    // Наименьшее значение, попадающее в корзину index
+    static uint64_t GetBucketLowerBound(size_t index) noexcept {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const size_t shift = index / SUB_BUCKET_COUNT - 1;
+        return (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    }
+
+    void Record(uint64_t value) noexcept {
+        ++counts_[GetBucketIndex(value)];
+        ++count_;
+        max_ = std::max(max_, value);
+    }
+
+    void AddBucket(size_t index, uint64_t count) noexcept {
+        counts_[index] += count;
+        count_ += count;
+    }
+
+    void Merge(const Histogram& other) noexcept {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    void UpdateMax(uint64_t value) noexcept {
+        max_ = std::max(max_, value);
+    }
+
+    uint64_t GetCount() const noexcept {
+        return count_;
+    }
+
+    uint64_t GetMax() const noexcept {
+        return max_;
+    }
+
+    // Нижняя граница корзины, в которую попадает перцентиль percentile (0..100)
+    uint64_t GetPercentile(double percentile) const noexcept {
+        if (count_ == 0) {
+            return 0;
+        }
+        const auto rank = static_cast<uint64_t>(percentile / 100.0 * (count_ - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts_[i];
+            if (seen > rank) {
+                return GetBucketLowerBound(i);
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts_ = {};
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+};
+
+namespace detail {
+
+// Гистограммы одного потока. Пишет только поток-владелец, поэтому вместо
+// атомарных инкрементов используются relaxed-чтение и запись: так снимок,
+// сделанный другим потоком, не содержит гонок по данным
+struct ThreadHistograms {
+    std::array<std::array<std::atomic<uint64_t>, Histogram::BUCKET_COUNT>, OP_COUNT> counts = {};
+    std::array<std::atomic<uint64_t>, OP_COUNT> max = {};
+
+    void Record(Op op, uint64_t value) noexcept {
+        const auto op_index = static_cast<size_t>(op);
+        auto& bucket = counts[op_index][Histogram::GetBucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (value > max[op_index].load(std::memory_order_relaxed)) {
+            max[op_index].store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void AddTo(Op op, Histogram& histogram) const noexcept {
+        const auto op_index = static_cast<size_t>(op);
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; ++i) {
+            if (const uint64_t count = counts[op_index][i].load(std::memory_order_relaxed)) {
+                histogram.AddBucket(i, count);
+            }
+        }
+        histogram.UpdateMax(max[op_index].load(std::memory_order_relaxed));
+    }
+
+    void Clear() noexcept {
+        for (auto& op_counts : counts) {
+            for (auto& count : op_counts) {
+                count.store(0, std::memory_order_relaxed);
+            }
+        }
+        for (auto& op_max : max) {
+            op_max.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Список гистограмм живых потоков и сумма гистограмм завершившихся
+class Registry {
+public:
+    // Экземпляр не разрушается, чтобы потоки, завершающиеся после main, могли в него писать
+    static Registry& Instance() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    void Add(ThreadHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        live_.push_back(histograms);
+    }
+
+    // Переносит данные завершающегося потока в общую гистограмму
+    void Retire(ThreadHistograms* histograms) {
+        std::lock_guard guard(mutex_);
+        for (size_t op = 0; op < OP_COUNT; ++op) {
+            histograms->AddTo(static_cast<Op>(op), retired_[op]);
+        }
+        live_.erase(std::find(live_.begin(), live_.end(), histograms));
+    }
+
+    Histogram Snapshot(Op op) {
+        std::lock_guard guard(mutex_);
+        Histogram result = retired_[static_cast<size_t>(op)];
+        for (const ThreadHistograms* histograms : live_) {
+            histograms->AddTo(op, result);
+        }
+        return result;
+    }
+
+    void Reset() {
+        std::lock_guard guard(mutex_);
+        retired_ = {};
+        for (ThreadHistograms* histograms : live_) {
+            histograms->Clear();
+        }
+    }
+
+private:
+    Registry() = default;
+
+    std::mutex mutex_;
+    std::vector<ThreadHistograms*> live_;
+    std::array<Histogram, OP_COUNT> retired_ = {};
+};
+
+// Гистограммы потока создаются при первом измерении и отдаются в Registry при завершении потока
+class ThreadSlot {
+public:
+    ~ThreadSlot() {
+        if (histograms_) {
+            Registry::Instance().Retire(histograms_);
+            delete histograms_;
+        }
+    }
+
+    ThreadHistograms& Get() {
+        if (!histograms_) {
+            histograms_ = new ThreadHistograms();
+            Registry::Instance().Add(histograms_);
+        }
+        return *histograms_;
+    }
+
+    // Сколько операций осталось пропустить до следующего измерения
+    uint32_t countdown = 0;
+
+private:
+    ThreadHistograms* histograms_ = nullptr;
+};
+
+inline std::atomic<uint32_t> sampling_rate{0};
+inline thread_local ThreadSlot thread_slot;
+
+}  // namespace detail
+
+// Измерять одну из каждых rate операций; 0 выключает измерения
+inline void SetSamplingRate(uint32_t rate) noexcept {
+    detail::sampling_rate.store(rate, std::memory_order_relaxed);
+}
+
+inline uint32_t GetSamplingRate() noexcept {
+    return detail::sampling_rate.load(std::memory_order_relaxed);
+}
+
+// Сумма гистограмм всех потоков для операции op, в тиках Now()
+inline Histogram Snapshot(Op op) {
+    return detail::Registry::Instance().Snapshot(op);
+}
+
+inline void Reset() {
+    detail::Registry::Instance().Reset();
+}
+
+// Печатает перцентили задержек всех операций в наносекундах
+inline void Dump(std::ostream& out) {
+    const double ticks_per_ns = GetTicksPerNanosecond();
+    out << std::setw(10) << "op" << std::setw(12) << "count";
+    for (const char* column : {"p50", "p90", "p99", "p99.9", "max"}) {
+        out << std::setw(10) << column;
+    }
+    out << "  (ns)\n";
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        const Histogram histogram = Snapshot(static_cast<Op>(op));
+        out << std::setw(10) << GetOpName(static_cast<Op>(op)) << std::setw(12) << histogram.GetCount();
+        for (const double percentile : {50.0, 90.0, 99.0, 99.9}) {
+            out << std::setw(10) << static_cast<uint64_t>(histogram.GetPercentile(percentile) / ticks_per_ns);
+        }
+        out << std::setw(10) << static_cast<uint64_t>(histogram.GetMax() / ticks_per_ns) << '\n';
+    }
+}
+
+// Измеряет время жизни объекта, если на эту операцию выпала выборка.
+// При нулевой частоте выборки стоит одного relaxed-чтения и ветвления
+class SampleScope {
+public:
+    explicit SampleScope(Op op) noexcept
+        : op_(op) {
+        const uint32_t rate = detail::sampling_rate.load(std::memory_order_relaxed);
+        if (rate == 0) {
+            return;
+        }
+        uint32_t& countdown = detail::thread_slot.countdown;
+        if (countdown > 0) {
+            --countdown;
+            return;
+        }
+        countdown = rate - 1;
+        start_ = Now();
+    }
+
+    SampleScope(const SampleScope&) = delete;
+    SampleScope& operator=(const SampleScope&) = delete;
+
+    ~SampleScope() {
+        if (start_ != 0) {
+            const uint64_t elapsed = Now() - start_;
+            try {
+                detail::thread_slot.Get().Record(op_, elapsed);
+            }
+            catch (...) {
+                // без памяти под гистограммы измерение теряется
+            }
+        }
+    }
+
+private:
+    Op op_;
+    uint64_t start_ = 0;
+};
+
+}  // namespace vector_latency
@@ -0,0 +1,447 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <source_location>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Профиль использования SimpleVector по месту создания.
+// Включается определением макроса SIMPLE_VECTOR_PROFILE до подключения simple_vector.h.
+// Каждый вектор считает свои операции и при разрушении добавляет их к статистике
+// места, где он был создан; перенос и обмен передают счётчики и место вместе с буфером.
+// Статистика копится в таблицах потоков без блокировок и выделений памяти
+// и сливается только при чтении. WriteReport печатает статистику мест и советы:
+// заранее вызывать Reserve, заменить вектор деком или gap-буфером, удалять без сохранения порядка.
+// Живые векторы в отчёт не попадают
+namespace vector_profile {
+
+// Счётчики одного вектора. Вектор не потокобезопасен, поэтому счётчики обычные
+struct InstanceStats {
+    uint64_t push_backs = 0;
+    uint64_t inserts = 0;
+    uint64_t front_inserts = 0;
+    uint64_t middle_inserts = 0;
+    uint64_t erases = 0;
+    uint64_t front_erases = 0;
+    uint64_t middle_erases = 0;
+    // Вставки и удаления на расстоянии не больше 1 от предыдущей правки
+    uint64_t local_edits = 0;
+    uint64_t reallocations = 0;
+    uint64_t reserves = 0;
+    size_t max_size = 0;
+
+    void OnPushBack(size_t new_size) noexcept {
+        ++push_backs;
+        max_size = std::max(max_size, new_size);
+    }
+
+    void OnInsert(size_t index, size_t size_before) noexcept {
+        ++inserts;
+        if (index == 0 && size_before > 0) {
+            ++front_inserts;
+        }
+        else if (index < size_before) {
+            ++middle_inserts;
+        }
+        OnEdit(index);
+        max_size = std::max(max_size, size_before + 1);
+    }
+
+    void OnErase(size_t index, size_t size_before) noexcept {
+        ++erases;
+        if (index == 0 && size_before > 1) {
+            ++front_erases;
+        }
+        else if (index + 1 < size_before) {
+            ++middle_erases;
+        }
+        OnEdit(index);
+    }
+
+    void OnResize(size_t new_size) noexcept {
+        max_size = std::max(max_size, new_size);
+    }
+
+    void OnReallocate() noexcept {
+        ++reallocations;
+    }
+
+    void OnReserve() noexcept {
+        ++reserves;
+    }
+
+private:
+    void OnEdit(size_t index) noexcept {
+        if (last_edit_ != NO_EDIT && index + 1 >= last_edit_ && index <= last_edit_ + 1) {
+            ++local_edits;
+        }
+        last_edit_ = index;
+    }
+
+    static constexpr size_t NO_EDIT = static_cast<size_t>(-1);
+    size_t last_edit_ = NO_EDIT;
+};
+
+// Сумма счётчиков всех разрушенных векторов одного места создания
+struct SiteStats {
+    std::string file;
+    uint32_t line = 0;
+    std::string function;
+
+    uint64_t instances = 0;
+    InstanceStats totals;
+    uint64_t max_size_sum = 0;
+    size_t max_size = 0;
+
+    uint64_t GetEdits() const noexcept {
+        return totals.inserts + totals.erases;
+    }
+
+    uint64_t GetOperations() const noexcept {
+        return totals.push_backs + GetEdits();
+    }
+};
+
+// Пороги, по которым выдаются советы
+constexpr uint64_t MIN_OPERATIONS_FOR_ADVICE = 64;
+constexpr double REALLOCATIONS_PER_INSTANCE_FOR_RESERVE = 2.0;
+constexpr double FRONT_SHARE_FOR_DEQUE = 0.25;
+constexpr double MIDDLE_SHARE_FOR_GAP_BUFFER = 0.25;
+constexpr double LOCAL_SHARE_FOR_GAP_BUFFER = 0.5;
+constexpr double MIDDLE_ERASE_SHARE_FOR_UNORDERED = 0.25;
+
+// Советы для места создания, по одному на строку
+inline std::vector<std::string> Recommend(const SiteStats& site) {
+    std::vector<std::string> advice;
+    const InstanceStats& t = site.totals;
+    if (site.instances == 0) {
+        return advice;
+    }
+    const double reallocations_per_instance = static_cast<double>(t.reallocations) / site.instances;
+    if (t.reserves == 0 && reallocations_per_instance > REALLOCATIONS_PER_INSTANCE_FOR_RESERVE) {
+        const uint64_t typical_size = (site.max_size_sum + site.instances - 1) / site.instances;
+        advice.push_back("call Reserve(" + std::to_string(typical_size) + ") after construction: "
+                         + std::to_string(t.reallocations) + " reallocations in "
+                         + std::to_string(site.instances) + " vectors, max size "
+                         + std::to_string(site.max_size));
+    }
+    const uint64_t operations = site.GetOperations();
+    if (operations < MIN_OPERATIONS_FOR_ADVICE) {
+        return advice;
+    }
+    const double front_share = static_cast<double>(t.front_inserts + t.front_erases) / operations;
+    const double middle_share = static_cast<double>(t.middle_inserts + t.middle_erases) / operations;
+    const double local_share = site.GetEdits() ? static_cast<double>(t.local_edits) / site.GetEdits() : 0.0;
+    if (front_share >= FRONT_SHARE_FOR_DEQUE) {
+        advice.push_back("use a deque-like container: "
+                         + std::to_string(t.front_inserts + t.front_erases) + " of "
+                         + std::to_string(operations) + " operations touch the front");
+    }
+    else if (middle_share >= MIDDLE_SHARE_FOR_GAP_BUFFER && local_share >= LOCAL_SHARE_FOR_GAP_BUFFER) {
+        advice.push_back("use a gap buffer: " + std::to_string(t.middle_inserts + t.middle_erases)
+                         + " middle inserts/erases, mostly next to the previous edit");
+    }
+    else if (t.middle_inserts == 0
+             && static_cast<double>(t.middle_erases) / operations >= MIDDLE_ERASE_SHARE_FOR_UNORDERED) {
+        advice.push_back("if order does not matter, erase by swapping with the last element and PopBack: "
+                         + std::to_string(t.middle_erases) + " middle erases");
+    }
+    return advice;
+}
+
+namespace detail {
+
+inline void Add(std::atomic<uint64_t>& counter, uint64_t value) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline uint64_t Load(const std::atomic<uint64_t>& counter) noexcept {
+    return counter.load(std::memory_order_relaxed);
+}
+
+// Счётчики одного места в таблице потока. Пишет только поток-владелец таблицы,
+// поэтому вместо атомарных инкрементов используются relaxed-чтение и запись:
+// отчёт, собираемый другим потоком, не содержит гонок по данным
+struct SiteCounters {
+    // Ключ места: указатель file_name() без копирования строки, строка и столбец.
+    // file записывается с release последним, после остальных полей ключа
+    std::atomic<const char*> file{nullptr};
+    const char* function = nullptr;
+    uint32_t line = 0;
+    uint32_t column = 0;
+
+    std::atomic<uint64_t> instances{0};
+    std::atomic<uint64_t> push_backs{0};
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> front_inserts{0};
+    std::atomic<uint64_t> middle_inserts{0};
+    std::atomic<uint64_t> erases{0};
+    std::atomic<uint64_t> front_erases{0};
+    std::atomic<uint64_t> middle_erases{0};
+    std::atomic<uint64_t> local_edits{0};
+    std::atomic<uint64_t> reallocations{0};
+    std::atomic<uint64_t> reserves{0};
+    std::atomic<uint64_t> max_size_sum{0};
+    std::atomic<uint64_t> max_size{0};
+
+    void Accumulate(const InstanceStats& stats) noexcept {
+        Add(instances, 1);
+        Add(push_backs, stats.push_backs);
+        Add(inserts, stats.inserts);
+        Add(front_inserts, stats.front_inserts);
+        Add(middle_inserts, stats.middle_inserts);
+        Add(erases, stats.erases);
+        Add(front_erases, stats.front_erases);
+        Add(middle_erases, stats.middle_erases);
+        Add(local_edits, stats.local_edits);
+        Add(reallocations, stats.reallocations);
+        Add(reserves, stats.reserves);
+        Add(max_size_sum, stats.max_size);
+        if (stats.max_size > Load(max_size)) {
+            max_size.store(stats.max_size, std::memory_order_relaxed);
+        }
+    }
+
+    void AddTo(SiteStats& site) const noexcept {
+        site.instances += Load(instances);
+        InstanceStats& t = site.totals;
+        t.push_backs += Load(push_backs);
+        t.inserts += Load(inserts);
+        t.front_inserts += Load(front_inserts);
+        t.middle_inserts += Load(middle_inserts);
+        t.erases += Load(erases);
+        t.front_erases += Load(front_erases);
+        t.middle_erases += Load(middle_erases);
+        t.local_edits += Load(local_edits);
+        t.reallocations += Load(reallocations);
+        t.reserves += Load(reserves);
+        site.max_size_sum += Load(max_size_sum);
+        site.max_size = std::max<size_t>(site.max_size, Load(max_size));
+    }
+
+    void Clear() noexcept {
+        for (std::atomic<uint64_t>* counter : {&instances, &push_backs, &inserts, &front_inserts, &middle_inserts,
+                                               &erases, &front_erases, &middle_erases, &local_edits,
+                                               &reallocations, &reserves, &max_size_sum, &max_size}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// Таблица мест одного потока с открытой адресацией. Выделяется один раз и не
+// освобождается, поэтому отчёт разрушаемого вектора не берёт блокировок и не выделяет память
+struct SiteTable {
+    static constexpr size_t CAPACITY = 256;
+
+    void Add(const std::source_location& location, const InstanceStats& stats) noexcept {
+        const char* const file = location.file_name();
+        const uint32_t line = location.line();
+        const uint32_t column = location.column();
+        size_t index = ((reinterpret_cast<uintptr_t>(file) >> 3) * 31 + line * 131 + column) % CAPACITY;
+        for (size_t probe = 0; probe < CAPACITY; ++probe) {
+            SiteCounters& site = sites[index];
+            const char* const site_file = site.file.load(std::memory_order_relaxed);
+            if (site_file == nullptr) {
+                site.function = location.function_name();
+                site.line = line;
+                site.column = column;
+                site.file.store(file, std::memory_order_release);
+                site.Accumulate(stats);
+                return;
+            }
+            if (site_file == file && site.line == line && site.column == column) {
+                site.Accumulate(stats);
+                return;
+            }
+            index = (index + 1) % CAPACITY;
+        }
+        detail::Add(dropped, 1);
+    }
+
+    std::array<SiteCounters, CAPACITY> sites;
+    // Векторы мест, которым не хватило таблицы
+    std::atomic<uint64_t> dropped{0};
+    // Поля ниже защищены мьютексом Registry
+    SiteTable* next = nullptr;
+    bool in_use = false;
+};
+
+class Registry {
+public:
+    // Экземпляр не разрушается: статические векторы отчитываются после выхода из main
+    static Registry& Instance() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // Отдаёт потоку свободную таблицу или создаёт новую. Таблица завершившегося
+    // потока переходит к следующему вместе со своими данными, так что они не теряются
+    SiteTable* Acquire() {
+        std::lock_guard guard(mutex_);
+        for (SiteTable* table = tables_; table; table = table->next) {
+            if (!table->in_use) {
+                table->in_use = true;
+                return table;
+            }
+        }
+        SiteTable* table = new SiteTable();
+        table->in_use = true;
+        table->next = tables_;
+        tables_ = table;
+        return table;
+    }
+
+    void Release(SiteTable* table) {
+        std::lock_guard guard(mutex_);
+        table->in_use = false;
+    }
+
+    std::vector<SiteStats> GetSites() {
+        std::map<Key, SiteStats> merged;
+        {
+            std::lock_guard guard(mutex_);
+            for (const SiteTable* table = tables_; table; table = table->next) {
+                for (const SiteCounters& counters : table->sites) {
+                    const char* const file = counters.file.load(std::memory_order_acquire);
+                    if (file == nullptr) {
+                        continue;
+                    }
+                    SiteStats& site = merged[Key{file, counters.line, counters.column}];
+                    if (site.file.empty()) {
+                        site.file = file;
+                        site.line = counters.line;
+                        site.function = counters.function;
+                    }
+                    counters.AddTo(site);
+                }
+            }
+        }
+        std::vector<SiteStats> result;
+        for (auto& [key, site] : merged) {
+            // места, обнулённые Reset, остаются в таблицах, но в отчёт не попадают
+            if (site.instances > 0) {
+                result.push_back(std::move(site));
+            }
+        }
+        return result;
+    }
+
+    uint64_t GetDroppedCount() {
+        std::lock_guard guard(mutex_);
+        uint64_t dropped = 0;
+        for (const SiteTable* table = tables_; table; table = table->next) {
+            dropped += Load(table->dropped);
+        }
+        return dropped;
+    }
+
+    void Reset() {
+        std::lock_guard guard(mutex_);
+        for (SiteTable* table = tables_; table; table = table->next) {
+            for (SiteCounters& counters : table->sites) {
+                counters.Clear();
+            }
+            table->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // Одно место из разных единиц трансляции сливается при сборе отчёта:
+    // source_location может вернуть разные указатели на одинаковые имена файлов
+    using Key = std::tuple<std::string, uint32_t, uint32_t>;
+
+    Registry() = default;
+
+    std::mutex mutex_;
+    SiteTable* tables_ = nullptr;
+};
+
+// Таблица потока берётся при первом отчёте. Указатель на неё тривиально
+// разрушаем, поэтому векторы, разрушаемые уже после thread_local-объектов потока,
+// тоже могут отчитаться; возвращает таблицу отдельный владелец
+inline thread_local SiteTable* thread_table = nullptr;
+
+struct ThreadTableOwner {
+    ~ThreadTableOwner() {
+        if (thread_table) {
+            Registry::Instance().Release(thread_table);
+            thread_table = nullptr;
+        }
+    }
+};
+
+inline thread_local ThreadTableOwner thread_table_owner;
+
+inline SiteTable& GetThreadTable() {
+    if (!thread_table) {
+        thread_table = Registry::Instance().Acquire();
+        // первое обращение регистрирует деструктор владельца при завершении потока
+        [[maybe_unused]] ThreadTableOwner* const owner = &thread_table_owner;
+    }
+    return *thread_table;
+}
+
+}  // namespace detail
+
+// Добавляет счётчики разрушаемого вектора к статистике места его создания.
+// Память выделяется только при первом отчёте потока, под его таблицу мест
+inline void Report(const std::source_location& location, const InstanceStats& stats) noexcept {
+    try {
+        detail::GetThreadTable().Add(location, stats);
+    }
+    catch (...) {
+        // без памяти под таблицу данные вектора теряются
+    }
+}
+
+// Статистика всех мест создания, отсортированная по убыванию числа операций
+inline std::vector<SiteStats> GetSites() {
+    std::vector<SiteStats> sites = detail::Registry::Instance().GetSites();
+    std::sort(sites.begin(), sites.end(), [](const SiteStats& lhs, const SiteStats& rhs) {
+        return std::tuple(lhs.GetOperations(), lhs.totals.reallocations)
+            > std::tuple(rhs.GetOperations(), rhs.totals.reallocations);
+    });
+    return sites;
+}
+
+// Число разрушенных векторов, не попавших в статистику: в таблице потока
+// не нашлось места под их место создания
+inline uint64_t GetDroppedCount() {
+    return detail::Registry::Instance().GetDroppedCount();
+}
+
+inline void Reset() {
+    detail::Registry::Instance().Reset();
+}
+
+inline void WriteReport(std::ostream& out) {
+    for (const SiteStats& site : GetSites()) {
+        const InstanceStats& t = site.totals;
+        // векторы без операций, например временные копии внутри operator=, не интересны
+        if (site.GetOperations() == 0 && t.reallocations == 0) {
+            continue;
+        }
+        out << site.file << ':' << site.line << " (" << site.function << ")\n"
+            << "  vectors: " << site.instances << ", max size: " << site.max_size
+            << ", reallocations: " << t.reallocations << ", Reserve calls: " << t.reserves << '\n'
+            << "  PushBack: " << t.push_backs
+            << ", Insert: " << t.inserts << " (front " << t.front_inserts << ", middle " << t.middle_inserts << ')'
+            << ", Erase: " << t.erases << " (front " << t.front_erases << ", middle " << t.middle_erases << ')'
+            << '\n';
+        for (const std::string& advice : Recommend(site)) {
+            out << "  advice: " << advice << '\n';
+        }
+    }
+    if (const uint64_t dropped = GetDroppedCount()) {
+        out << dropped << " vectors not counted: per-thread site table is full\n";
+    }
+}
+
+}  // namespace vector_profile
@@ -0,0 +1,292 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "simple_vector.h"
+
+// Поиск ближайших строк перебором. Строки длины dim лежат подряд в одном SimpleVector<float>.
+// Расстояния считаются группами по 4 строки: каждая загрузка запроса используется четырьмя
+// строками (ядра AVX-512 или AVX2 с FMA, если доступны, иначе скалярные), а TopKSelector
+// держит k лучших строк в куче, не сохраняя расстояния до всех строк
+enum class Metric {
+    // Квадрат евклидова расстояния
+    L2,
+    // Скалярное произведение со знаком минус: большее произведение ближе
+    Dot,
+    // 1 - косинус угла; для нулевых векторов 1
+    Cosine,
+};
+
+struct SearchHit {
+    size_t row = 0;
+    float distance = 0.0f;
+};
+
+namespace search_detail {
+
+constexpr size_t ROW_GROUP = 4;
+// Расстояния считаются порциями, чтобы буфер оставался на стеке
+constexpr size_t BATCH_ROWS = 256;
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+inline float HorizontalSum(__m256 value) noexcept {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#if defined(__AVX512F__)
+// Половины складываются через память: _mm512_reduce_add_ps и перестановки полос
+// в GCC 12 дают ложное предупреждение -Wuninitialized
+inline float HorizontalSum(__m512 value) noexcept {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, value);
+    return HorizontalSum(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+}
+#endif
+
+// Для Rows строк считает primary (L2: сумма квадратов разностей, иначе скалярное произведение)
+// и для Cosine квадраты норм строк
+template <Metric M, size_t Rows>
+inline void ScoreGroup(const float* rows, size_t dim, const float* query, float* primary, float* norms) noexcept {
+    size_t i = 0;
+    float tails[Rows] = {};
+    float tail_norms[Rows] = {};
+#if defined(__AVX512F__)
+    __m512 sums[Rows];
+    __m512 squares[Rows];
+    for (size_t r = 0; r < Rows; ++r) {
+        sums[r] = _mm512_setzero_ps();
+        squares[r] = _mm512_setzero_ps();
+    }
+    auto step = [&](__mmask16 mask) {
+        const __m512 q = _mm512_maskz_loadu_ps(mask, query + i);
+        for (size_t r = 0; r < Rows; ++r) {
+            const __m512 x = _mm512_maskz_loadu_ps(mask, rows + r * dim + i);
+            if constexpr (M == Metric::L2) {
+                const __m512 difference = _mm512_sub_ps(x, q);
+                sums[r] = _mm512_fmadd_ps(difference, difference, sums[r]);
+            }
+            else {
+                sums[r] = _mm512_fmadd_ps(x, q, sums[r]);
+            }
+            if constexpr (M == Metric::Cosine) {
+                squares[r] = _mm512_fmadd_ps(x, x, squares[r]);
+            }
+        }
+    };
+    for (; i + 16 <= dim; i += 16) {
+        step(0xffff);
+    }
+    if (i < dim) {
+        // хвост читается маской, без выхода за конец строки
+        step(static_cast<__mmask16>((1u << (dim - i)) - 1));
+        i = dim;
+    }
+    for (size_t r = 0; r < Rows; ++r) {
+        tails[r] = HorizontalSum(sums[r]);
+        tail_norms[r] = HorizontalSum(squares[r]);
+    }
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256 sums[Rows];
+    __m256 squares[Rows];
+    for (size_t r = 0; r < Rows; ++r) {
+        sums[r] = _mm256_setzero_ps();
+        squares[r] = _mm256_setzero_ps();
+    }
+    for (; i + 8 <= dim; i += 8) {
+        const __m256 q = _mm256_loadu_ps(query + i);
+        for (size_t r = 0; r < Rows; ++r) {
+            const __m256 x = _mm256_loadu_ps(rows + r * dim + i);
+            if constexpr (M == Metric::L2) {
+                const __m256 difference = _mm256_sub_ps(x, q);
+                sums[r] = _mm256_fmadd_ps(difference, difference, sums[r]);
+            }
+            else {
+                sums[r] = _mm256_fmadd_ps(x, q, sums[r]);
+            }
+            if constexpr (M == Metric::Cosine) {
+                squares[r] = _mm256_fmadd_ps(x, x, squares[r]);
+            }
+        }
+    }
+    for (size_t r = 0; r < Rows; ++r) {
+        tails[r] = HorizontalSum(sums[r]);
+        tail_norms[r] = HorizontalSum(squares[r]);
+    }
+#endif
+    for (; i < dim; ++i) {
+        for (size_t r = 0; r < Rows; ++r) {
+            const float x = rows[r * dim + i];
+            if constexpr (M == Metric::L2) {
+                tails[r] += (x - query[i]) * (x - query[i]);
+            }
+            else {
+                tails[r] += x * query[i];
+            }
+            if constexpr (M == Metric::Cosine) {
+                tail_norms[r] += x * x;
+            }
+        }
+    }
+    for (size_t r = 0; r < Rows; ++r) {
+        primary[r] = tails[r];
+        norms[r] = tail_norms[r];
+    }
+}
+
+template <Metric M>
+inline float ToDistance(float primary, float norm, float query_norm) noexcept {
+    if constexpr (M == Metric::L2) {
+        return primary;
+    }
+    else if constexpr (M == Metric::Dot) {
+        return -primary;
+    }
+    else {
+        const float denominator = std::sqrt(norm * query_norm);
+        return denominator > 0.0f ? 1.0f - primary / denominator : 1.0f;
+    }
+}
+
+template <Metric M>
+void ComputeDistances(const float* rows, size_t dim, const float* query, size_t count, float* out) noexcept {
+    float query_norm = 0.0f;
+    if constexpr (M == Metric::Cosine) {
+        for (size_t i = 0; i < dim; ++i) {
+            query_norm += query[i] * query[i];
+        }
+    }
+    float primary[ROW_GROUP];
+    float norms[ROW_GROUP];
+    size_t row = 0;
+    for (; row + ROW_GROUP <= count; row += ROW_GROUP) {
+        ScoreGroup<M, ROW_GROUP>(rows + row * dim, dim, query, primary, norms);
+        for (size_t r = 0; r < ROW_GROUP; ++r) {
+            out[row + r] = ToDistance<M>(primary[r], norms[r], query_norm);
+        }
+    }
+    for (; row < count; ++row) {
+        ScoreGroup<M, 1>(rows + row * dim, dim, query, primary, norms);
+        out[row] = ToDistance<M>(primary[0], norms[0], query_norm);
+    }
+}
+
+}  // namespace search_detail
+
+// k строк с наименьшими расстояниями среди переданных в Push. Куча хранит худшую из
+// отобранных строк в вершине, поэтому строка, не попадающая в ответ, отсеивается одним сравнением.
+// При равных расстояниях выигрывает меньший номер строки; NaN пропускается
+class TopKSelector {
+public:
+    explicit TopKSelector(size_t k)
+        : k_(k)
+    {
+        heap_.Reserve(k);
+    }
+
+    size_t GetK() const noexcept {
+        return k_;
+    }
+
+    bool IsFull() const noexcept {
+        return heap_.GetSize() == k_;
+    }
+
+    // Расстояние, которое нужно превзойти, чтобы попасть в ответ
+    float GetThreshold() const noexcept {
+        return IsFull() && k_ > 0 ? heap_.begin()->distance : std::numeric_limits<float>::infinity();
+    }
+
+    void Push(size_t row, float distance) {
+        if (k_ == 0 || std::isnan(distance)) {
+            return;
+        }
+        const SearchHit hit{row, distance};
+        if (!IsFull()) {
+            heap_.PushBack(hit);
+            std::push_heap(heap_.begin(), heap_.end(), Closer);
+        }
+        else if (Closer(hit, *heap_.begin())) {
+            std::pop_heap(heap_.begin(), heap_.end(), Closer);
+            heap_[heap_.GetSize() - 1] = hit;
+            std::push_heap(heap_.begin(), heap_.end(), Closer);
+        }
+    }
+
+    // Отдаёт отобранные строки от ближней к дальней. Селектор становится пустым
+    SimpleVector<SearchHit> Take() {
+        std::sort_heap(heap_.begin(), heap_.end(), Closer);
+        SimpleVector<SearchHit> result(std::move(heap_));
+        heap_.Reserve(k_);
+        return result;
+    }
+
+private:
+    static bool Closer(const SearchHit& lhs, const SearchHit& rhs) noexcept {
+        return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.row < rhs.row);
+    }
+
+    size_t k_;
+    SimpleVector<SearchHit> heap_;
+};
+
+// Записывает в out расстояния от query до строк [first_row, first_row + count) матрицы rows
+// с dim столбцами. Выбрасывает std::invalid_argument при несогласованных размерах
+// и std::out_of_range, если строки выходят за матрицу
+inline void ComputeDistances(const SimpleVector<float>& rows, size_t dim, const SimpleVector<float>& query,
+                             Metric metric, size_t first_row, size_t count, float* out) {
+    if (dim == 0 || rows.GetSize() % dim != 0 || query.GetSize() != dim) {
+        throw std::invalid_argument("rows and query sizes do not match dim");
+    }
+    const size_t row_count = rows.GetSize() / dim;
+    if (first_row > row_count || count > row_count - first_row) {
+        throw std::out_of_range("rows range exceeds matrix");
+    }
+    const float* const data = rows.begin() + first_row * dim;
+    switch (metric) {
+    case Metric::L2:
+        search_detail::ComputeDistances<Metric::L2>(data, dim, query.begin(), count, out);
+        break;
+    case Metric::Dot:
+        search_detail::ComputeDistances<Metric::Dot>(data, dim, query.begin(), count, out);
+        break;
+    case Metric::Cosine:
+        search_detail::ComputeDistances<Metric::Cosine>(data, dim, query.begin(), count, out);
+        break;
+    }
+}
+
+// k ближайших к query строк матрицы rows с dim столбцами, от ближней к дальней.
+// Расстояния считаются порциями по BATCH_ROWS строк и сразу отбираются TopKSelector
+inline SimpleVector<SearchHit> SearchTopK(const SimpleVector<float>& rows, size_t dim,
+                                          const SimpleVector<float>& query, size_t k, Metric metric) {
+    if (dim == 0 || rows.GetSize() % dim != 0) {
+        throw std::invalid_argument("rows size is not a multiple of dim");
+    }
+    const size_t row_count = rows.GetSize() / dim;
+    TopKSelector selector(std::min(k, row_count));
+    float distances[search_detail::BATCH_ROWS];
+    for (size_t first = 0; first < row_count; first += search_detail::BATCH_ROWS) {
+        const size_t count = std::min(search_detail::BATCH_ROWS, row_count - first);
+        ComputeDistances(rows, dim, query, metric, first, count, distances);
+        float threshold = selector.GetThreshold();
+        for (size_t i = 0; i < count; ++i) {
+            if (distances[i] < threshold || !selector.IsFull()) {
+                selector.Push(first + i, distances[i]);
+                threshold = selector.GetThreshold();
+            }
+        }
+    }
+    return selector.Take();
+}
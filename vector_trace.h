@@ -0,0 +1,246 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Запись трассы операций SimpleVector в компактный двоичный файл.
+// Включается определением макроса SIMPLE_VECTOR_TRACE до подключения simple_vector.h,
+// после чего запись идёт между вызовами StartTrace и StopTrace.
+// Формат: сигнатура TRACE_MAGIC, затем записи вида
+// [код операции: 1 байт][varint: zigzag-разность адреса вектора с предыдущим][varint: аргумент].
+// Для операций с другим вектором аргумент — zigzag-разность его адреса с адресом текущего.
+// Копирующее присваивание записывается так, как оно реализовано: копия, обмен и разрушение копии
+namespace vector_trace {
+
+constexpr char TRACE_MAGIC[8] = {'S', 'V', 'T', 'R', 'A', 'C', 'E', '1'};
+
+enum class Op : uint8_t {
+    Construct,      // аргумент — начальный размер
+    CopyConstruct,  // аргумент — источник
+    MoveConstruct,  // аргумент — источник
+    MoveAssign,     // аргумент — источник
+    Destroy,
+    PushBack,
+    Insert,         // аргумент — индекс вставки
+    Erase,          // аргумент — индекс удаляемого элемента
+    Resize,         // аргумент — новый размер
+    Reserve,        // аргумент — новая вместимость
+    PopBack,
+    Clear,
+    Swap,           // аргумент — второй вектор
+    ShrinkToFit,
+};
+
+constexpr uint8_t OP_COUNT = static_cast<uint8_t>(Op::ShrinkToFit) + 1;
+
+// Сообщает, что аргумент операции — адрес другого вектора
+inline bool HasVectorArgument(Op op) {
+    switch (op) {
+    case Op::CopyConstruct:
+    case Op::MoveConstruct:
+    case Op::MoveAssign:
+    case Op::Swap:
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct Record {
+    Op op = Op::Construct;
+    uint64_t id = 0;
+    uint64_t arg = 0;
+};
+
+inline uint64_t ZigZagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+class Recorder {
+public:
+    // Экземпляр намеренно не разрушается: векторы со статическим временем жизни
+    // могут обращаться к нему после выхода из main. Запись нужно завершить StopTrace
+    static Recorder& Instance() {
+        static Recorder* recorder = new Recorder();
+        return *recorder;
+    }
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Начинает запись в файл path. Возвращает false, если файл не удалось открыть
+    bool Start(const std::string& path) {
+        std::lock_guard guard(mutex_);
+        if (file_) {
+            return false;
+        }
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            return false;
+        }
+        std::fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), file_);
+        last_id_ = 0;
+        active_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Сбрасывает буфер и закрывает файл
+    void Stop() {
+        std::lock_guard guard(mutex_);
+        active_.store(false, std::memory_order_release);
+        if (file_) {
+            Flush();
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    bool IsActive() const noexcept {
+        return active_.load(std::memory_order_relaxed);
+    }
+
+    void Write(Op op, uint64_t id, uint64_t arg) {
+        std::lock_guard guard(mutex_);
+        if (!file_) {
+            return;
+        }
+        if (HasVectorArgument(op)) {
+            arg = ZigZagEncode(static_cast<int64_t>(arg - id));
+        }
+        buffer_.push_back(static_cast<char>(op));
+        PutVarint(ZigZagEncode(static_cast<int64_t>(id - last_id_)));
+        PutVarint(arg);
+        last_id_ = id;
+        if (buffer_.size() >= FLUSH_THRESHOLD) {
+            Flush();
+        }
+    }
+
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    Recorder() = default;
+
+    void PutVarint(uint64_t value) {
+        while (value >= 0x80) {
+            buffer_.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    void Flush() {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+
+    std::atomic<bool> active_{false};
+    std::mutex mutex_;
+    std::FILE* file_ = nullptr;
+    std::vector<char> buffer_;
+    uint64_t last_id_ = 0;
+};
+
+inline bool StartTrace(const std::string& path) {
+    return Recorder::Instance().Start(path);
+}
+
+inline void StopTrace() {
+    Recorder::Instance().Stop();
+}
+
+// Точка записи, вызываемая из SimpleVector. Пока запись не запущена,
+// стоит одного relaxed-чтения атомарного флага. Вызывается и из noexcept-методов,
+// поэтому при нехватке памяти запись теряется, а не выбрасывает исключение
+inline void RecordOp(Op op, const void* vector, uint64_t arg = 0) noexcept {
+    Recorder& recorder = Recorder::Instance();
+    if (recorder.IsActive()) {
+        try {
+            recorder.Write(op, reinterpret_cast<uintptr_t>(vector), arg);
+        }
+        catch (...) {
+        }
+    }
+}
+
+inline void RecordOp(Op op, const void* vector, const void* other) noexcept {
+    RecordOp(op, vector, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(other)));
+}
+
+// Последовательное чтение трассы, записанной Recorder
+class Reader {
+public:
+    explicit Reader(const std::string& path)
+        : file_(std::fopen(path.c_str(), "rb")) {
+        char magic[sizeof(TRACE_MAGIC)] = {};
+        if (file_ && (std::fread(magic, 1, sizeof(magic), file_) != sizeof(magic)
+                      || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader() {
+        if (file_) {
+            std::fclose(file_);
+        }
+    }
+
+    // Сообщает, открыт ли файл и совпала ли сигнатура
+    explicit operator bool() const noexcept {
+        return file_ != nullptr;
+    }
+
+    // Читает очередную запись. Возвращает false в конце файла или на повреждённой записи
+    bool Next(Record& record) {
+        if (!file_) {
+            return false;
+        }
+        const int op = std::fgetc(file_);
+        uint64_t id_delta = 0;
+        uint64_t arg = 0;
+        if (op == EOF || op >= OP_COUNT || !GetVarint(id_delta) || !GetVarint(arg)) {
+            return false;
+        }
+        record.op = static_cast<Op>(op);
+        record.id = last_id_ + static_cast<uint64_t>(ZigZagDecode(id_delta));
+        record.arg = HasVectorArgument(record.op)
+            ? record.id + static_cast<uint64_t>(ZigZagDecode(arg))
+            : arg;
+        last_id_ = record.id;
+        return true;
+    }
+
+private:
+    bool GetVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const int byte = std::fgetc(file_);
+            if (byte == EOF) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::FILE* file_ = nullptr;
+    uint64_t last_id_ = 0;
+};
+
+}  // namespace vector_trace